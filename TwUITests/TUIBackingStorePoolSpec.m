@@ -0,0 +1,206 @@
+//
+//  TUIBackingStorePoolSpec.m
+//  TwUITests
+//
+
+#import "TUIBackingStorePool.h"
+
+// Fills the whole context with opaque white.
+static void fillWhite(CGContextRef context) {
+	CGContextSetRGBFillColor(context, 1.0, 1.0, 1.0, 1.0);
+	CGContextFillRect(context, CGRectMake(0, 0, CGBitmapContextGetWidth(context), CGBitmapContextGetHeight(context)));
+}
+
+SpecBegin(TUIBackingStorePool)
+
+__block TUIBackingStorePool *pool = nil;
+
+beforeEach(^{
+	// a pool of its own, so the counts start from nothing
+	pool = [[TUIBackingStorePool alloc] init];
+});
+
+afterEach(^{
+	// every spec releases its contexts and images before it ends
+	expect(pool.bytesInUse).to.equal(0);
+	pool = nil;
+});
+
+describe(@"bucketing", ^{
+	it(@"should reuse a buffer for a context of the same bucket", ^{
+		CGContextRef context = [pool createContextWithPixelSize:CGSizeMake(100, 100) opaque:YES];
+		expect(pool.missCount).to.equal(1);
+		CGContextRelease(context);
+
+		// rounded up to 128x128, at 4 bytes per pixel
+		expect(pool.bytesHeld).to.equal(128 * 128 * 4);
+
+		context = [pool createContextWithPixelSize:CGSizeMake(110, 120) opaque:NO];
+		expect(pool.hitCount).to.equal(1);
+		expect(pool.bytesHeld).to.equal(0);
+		expect(CGBitmapContextGetWidth(context)).to.equal(110);
+		expect(CGBitmapContextGetHeight(context)).to.equal(120);
+		CGContextRelease(context);
+	});
+
+	it(@"should not reuse a buffer for a context of another bucket", ^{
+		CGContextRef context = [pool createContextWithPixelSize:CGSizeMake(100, 100) opaque:YES];
+		CGContextRelease(context);
+
+		context = [pool createContextWithPixelSize:CGSizeMake(200, 200) opaque:YES];
+		expect(pool.hitCount).to.equal(0);
+		expect(pool.missCount).to.equal(2);
+		expect(pool.bytesHeld).to.equal(128 * 128 * 4);
+		CGContextRelease(context);
+	});
+
+	it(@"should share buckets between formats of the same byte size", ^{
+		CGContextRef context = [pool createContextWithPixelSize:CGSizeMake(64, 64) opaque:NO];
+		CGContextRelease(context);
+
+		context = [pool createContextWithPixelSize:CGSizeMake(128, 128) format:TUIBackingStoreFormatGray8 opaque:YES];
+		expect(pool.hitCount).to.equal(1);
+		expect(CGBitmapContextGetBitsPerPixel(context)).to.equal(8);
+		CGContextRelease(context);
+	});
+
+	it(@"should fall back to 32 bits per pixel for formats that can't be transparent", ^{
+		CGContextRef context = [pool createContextWithPixelSize:CGSizeMake(32, 32) format:TUIBackingStoreFormatGray8 opaque:NO];
+		expect(CGBitmapContextGetBitsPerPixel(context)).to.equal(32);
+		CGContextRelease(context);
+
+		context = [pool createContextWithPixelSize:CGSizeMake(32, 32) format:TUIBackingStoreFormatRGB16 opaque:NO];
+		expect(CGBitmapContextGetBitsPerPixel(context)).to.equal(32);
+		CGContextRelease(context);
+	});
+
+	it(@"should hand out pooled contexts cleared", ^{
+		CGContextRef context = [pool createContextWithPixelSize:CGSizeMake(32, 32) opaque:NO];
+		fillWhite(context);
+		CGContextRelease(context);
+
+		context = [pool createContextWithPixelSize:CGSizeMake(32, 32) opaque:NO];
+		expect(pool.hitCount).to.equal(1);
+		const uint32_t *pixels = CGBitmapContextGetData(context);
+		BOOL cleared = YES;
+		for (size_t i = 0; i < 32 * 32; i++)
+			cleared = cleared && pixels[i] == 0;
+		expect(cleared).to.beTruthy();
+		CGContextRelease(context);
+	});
+});
+
+describe(@"budget", ^{
+	it(@"should free the oldest idle buffers beyond the budget", ^{
+		pool.byteBudget = 70000;
+		CGContextRef large = [pool createContextWithPixelSize:CGSizeMake(128, 128) opaque:YES];
+		CGContextRef small = [pool createContextWithPixelSize:CGSizeMake(64, 64) opaque:YES];
+		CGContextRelease(large);
+		CGContextRelease(small);
+
+		expect(pool.bytesHeld).to.equal(64 * 64 * 4);
+
+		small = [pool createContextWithPixelSize:CGSizeMake(64, 64) opaque:YES];
+		large = [pool createContextWithPixelSize:CGSizeMake(128, 128) opaque:YES];
+		expect(pool.hitCount).to.equal(1);
+		expect(pool.missCount).to.equal(3);
+		CGContextRelease(small);
+		CGContextRelease(large);
+	});
+
+	it(@"should never hold on to a buffer larger than the budget", ^{
+		pool.byteBudget = 1024;
+		CGContextRef context = [pool createContextWithPixelSize:CGSizeMake(64, 64) opaque:YES];
+		CGContextRelease(context);
+
+		expect(pool.bytesHeld).to.equal(0);
+	});
+
+	it(@"should free idle buffers when the budget is lowered", ^{
+		CGContextRef context = [pool createContextWithPixelSize:CGSizeMake(64, 64) opaque:YES];
+		CGContextRelease(context);
+		expect(pool.bytesHeld).to.equal(64 * 64 * 4);
+
+		pool.byteBudget = 0;
+		expect(pool.bytesHeld).to.equal(0);
+	});
+
+	it(@"should free every idle buffer when purged", ^{
+		CGContextRef a = [pool createContextWithPixelSize:CGSizeMake(64, 64) opaque:YES];
+		CGContextRef b = [pool createContextWithPixelSize:CGSizeMake(128, 128) opaque:YES];
+		CGContextRelease(a);
+		CGContextRelease(b);
+		expect(pool.bytesHeld).to.equal(64 * 64 * 4 + 128 * 128 * 4);
+
+		[pool purge];
+		expect(pool.bytesHeld).to.equal(0);
+	});
+});
+
+describe(@"stats", ^{
+	it(@"should count buffers lent out as in use", ^{
+		CGContextRef a = [pool createContextWithPixelSize:CGSizeMake(64, 64) opaque:YES];
+		CGContextRef b = [pool createContextWithPixelSize:CGSizeMake(64, 64) opaque:YES];
+		expect(pool.bytesInUse).to.equal(2 * 64 * 64 * 4);
+
+		CGContextRelease(a);
+		expect(pool.bytesInUse).to.equal(64 * 64 * 4);
+		expect(pool.bytesHeld).to.equal(64 * 64 * 4);
+
+		CGContextRelease(b);
+		expect(pool.bytesHeld).to.equal(2 * 64 * 64 * 4);
+	});
+});
+
+describe(@"detaching", ^{
+	it(@"should keep a detached image's buffer in use until the image is freed", ^{
+		CGContextRef context = [pool createContextWithPixelSize:CGSizeMake(100, 100) opaque:YES];
+		CGImageRef image = [pool createImageByDetachingContext:context];
+
+		expect(image != NULL).to.beTruthy();
+		expect(pool.bytesInUse).to.equal(128 * 128 * 4);
+		expect(pool.bytesHeld).to.equal(0);
+
+		CGImageRelease(image);
+		expect(pool.bytesInUse).to.equal(0);
+		expect(pool.bytesHeld).to.equal(128 * 128 * 4);
+	});
+
+	it(@"should copy the pixels of a detached image into a context", ^{
+		CGContextRef context = [pool createContextWithPixelSize:CGSizeMake(32, 32) opaque:NO];
+		fillWhite(context);
+		CGImageRef image = [pool createImageByDetachingContext:context];
+
+		context = [pool createContextWithPixelSize:CGSizeMake(32, 32) opaque:NO];
+		expect([pool copyPixelsOfImage:image toContext:context]).to.beTruthy();
+		const uint32_t *pixels = CGBitmapContextGetData(context);
+		expect(pixels[0]).to.equal(0xFFFFFFFF);
+		expect(pixels[32 * 32 - 1]).to.equal(0xFFFFFFFF);
+
+		CGContextRelease(context);
+		CGImageRelease(image);
+	});
+
+	it(@"should not copy the pixels of any other image", ^{
+		CGContextRef context = [pool createContextWithPixelSize:CGSizeMake(32, 32) opaque:NO];
+		CGImageRef image = CGBitmapContextCreateImage(context);
+
+		expect([pool copyPixelsOfImage:image toContext:context]).to.beFalsy();
+
+		CGImageRelease(image);
+		CGContextRelease(context);
+	});
+
+	it(@"should still return an image for an alpha-only context", ^{
+		CGContextRef context = [pool createContextWithPixelSize:CGSizeMake(32, 32) format:TUIBackingStoreFormatAlpha8 opaque:NO];
+		CGImageRef image = [pool createImageByDetachingContext:context];
+
+		expect(image != NULL).to.beTruthy();
+		// copied out, so the buffer went straight back to the pool
+		expect(pool.bytesHeld).to.equal(32 * 32);
+
+		CGImageRelease(image);
+	});
+});
+
+SpecEnd
@@ -0,0 +1,190 @@
+//
+//  TUIDisplayPassSpec.m
+//  TwUITests
+//
+
+#import "TUIDisplayPass.h"
+#import "TUINSView.h"
+#import "TUIView.h"
+
+// The pass the run loop observer makes, which is the one that keeps to the
+// budget; -displayPendingViews doesn't.
+@interface TUIDisplayPass (TUIDisplayPassSpec)
+- (void)_displayPendingViewsWithinBudget:(BOOL)budgeted;
+@end
+
+// A view that notes its name each time it draws, taking delay to do it.
+static TUIView *recordingView(CGRect frame, NSString *name, NSMutableArray *displayed, useconds_t delay) {
+	TUIView *view = [[TUIView alloc] initWithFrame:frame];
+	view.drawRect = ^(TUIView *v, CGRect rect) {
+		if (delay > 0)
+			usleep(delay);
+		[displayed addObject:name];
+	};
+	return view;
+}
+
+SpecBegin(TUIDisplayPass)
+
+__block TUIDisplayPass *pass = nil;
+__block NSTimeInterval savedBudget = 0.0;
+__block NSWindow *window = nil;
+__block TUIView *rootView = nil;
+__block NSMutableArray *displayed = nil;
+
+// views on screen, and views in the window but out of sight
+__block TUIView *a = nil;
+__block TUIView *b = nil;
+__block TUIView *c = nil;
+__block TUIView *d = nil;
+
+beforeEach(^{
+	// the shared pass, since a pass watches the run loop for as long as the
+	// app runs
+	pass = [TUIDisplayPass sharedDisplayPass];
+	savedBudget = pass.frameBudget;
+
+	window = [[NSWindow alloc] initWithContentRect:NSMakeRect(0, 0, 400, 400) styleMask:NSBorderlessWindowMask backing:NSBackingStoreBuffered defer:NO];
+	[window setReleasedWhenClosed:NO];
+	TUINSView *nsView = [[TUINSView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+	rootView = [[TUIView alloc] initWithFrame:CGRectMake(0, 0, 400, 400)];
+	nsView.rootView = rootView;
+	[window setContentView:nsView];
+	[window orderFront:nil];
+
+	displayed = [NSMutableArray array];
+	a = recordingView(CGRectMake(0, 0, 50, 50), @"a", displayed, 3000);
+	b = recordingView(CGRectMake(100, 0, 50, 50), @"b", displayed, 3000);
+	c = recordingView(CGRectMake(5000, 0, 50, 50), @"c", displayed, 0);
+	d = recordingView(CGRectMake(5100, 0, 50, 50), @"d", displayed, 0);
+	for (TUIView *view in [NSArray arrayWithObjects:a, b, c, d, nil])
+		[rootView addSubview:view];
+
+	// start from nothing pending
+	[pass displayPendingViews];
+	[displayed removeAllObjects];
+});
+
+afterEach(^{
+	pass.frameBudget = savedBudget;
+	pass.overrunHandler = nil;
+	[pass displayPendingViews];
+
+	[window orderOut:nil];
+	window = nil;
+	rootView = nil;
+});
+
+describe(@"queueing", ^{
+	it(@"should queue a view once however often it is marked", ^{
+		[pass setNeedsDisplayForView:a];
+		[pass setNeedsDisplayForView:a];
+
+		expect(pass.pendingViewCount).to.equal(1);
+		expect([pass needsDisplayForView:a]).to.beTruthy();
+		expect([pass needsDisplayForView:b]).to.beFalsy();
+	});
+
+	it(@"should display a queued view on request", ^{
+		[pass setNeedsDisplayForView:a];
+		[pass displayViewIfNeeded:a];
+		[pass displayViewIfNeeded:b];
+
+		expect(displayed).to.equal([NSArray arrayWithObject:@"a"]);
+		expect([pass needsDisplayForView:a]).to.beFalsy();
+		expect(pass.pendingViewCount).to.equal(0);
+	});
+
+	it(@"should leave views outside a window to Core Animation", ^{
+		TUIView *detached = recordingView(CGRectMake(0, 0, 50, 50), @"detached", displayed, 0);
+		[pass setNeedsDisplayForView:detached];
+		[pass _displayPendingViewsWithinBudget:YES];
+
+		expect([displayed count]).to.equal(0);
+		expect([pass needsDisplayForView:detached]).to.beFalsy();
+		expect(detached.layer.needsDisplay).to.beTruthy();
+	});
+});
+
+describe(@"ordering", ^{
+	it(@"should display views on screen first, most recently marked first", ^{
+		pass.frameBudget = 0.0;
+		[pass setNeedsDisplayForView:c];
+		[pass setNeedsDisplayForView:a];
+		[pass setNeedsDisplayForView:d];
+		[pass setNeedsDisplayForView:b];
+		[pass _displayPendingViewsWithinBudget:YES];
+
+		expect(displayed).to.equal([NSArray arrayWithObjects:@"b", @"a", @"d", @"c", nil]);
+	});
+});
+
+describe(@"budget", ^{
+	__block NSUInteger overruns = 0;
+	__block NSUInteger deferredCount = 0;
+
+	beforeEach(^{
+		overruns = 0;
+		deferredCount = 0;
+		pass.overrunHandler = ^(NSTimeInterval duration, NSUInteger deferred) {
+			overruns++;
+			deferredCount = deferred;
+		};
+	});
+
+	it(@"should always display views on screen, deferring those out of sight once over budget", ^{
+		// each view on screen takes 3ms to draw
+		pass.frameBudget = 0.001;
+		NSUInteger overrunCount = pass.overrunCount;
+		for (TUIView *view in [NSArray arrayWithObjects:a, b, c, d, nil])
+			[pass setNeedsDisplayForView:view];
+		[pass _displayPendingViewsWithinBudget:YES];
+
+		expect(displayed).to.equal([NSArray arrayWithObjects:@"b", @"a", nil]);
+		expect(pass.pendingViewCount).to.equal(2);
+		expect([pass needsDisplayForView:c]).to.beTruthy();
+		expect([pass needsDisplayForView:d]).to.beTruthy();
+
+		expect(pass.overrunCount).to.equal(overrunCount + 1);
+		expect(overruns).to.equal(1);
+		expect(deferredCount).to.equal(2);
+	});
+
+	it(@"should display deferred views in a later pass", ^{
+		pass.frameBudget = 0.001;
+		for (TUIView *view in [NSArray arrayWithObjects:a, b, c, d, nil])
+			[pass setNeedsDisplayForView:view];
+		[pass _displayPendingViewsWithinBudget:YES];
+		[displayed removeAllObjects];
+
+		[pass _displayPendingViewsWithinBudget:YES];
+		expect(displayed).to.contain(@"c");
+		expect(displayed).to.contain(@"d");
+		expect(pass.pendingViewCount).to.equal(0);
+	});
+
+	it(@"should never defer without a budget", ^{
+		pass.frameBudget = 0.0;
+		NSUInteger overrunCount = pass.overrunCount;
+		for (TUIView *view in [NSArray arrayWithObjects:a, b, c, d, nil])
+			[pass setNeedsDisplayForView:view];
+		[pass _displayPendingViewsWithinBudget:YES];
+
+		expect([displayed count]).to.equal(4);
+		expect(pass.pendingViewCount).to.equal(0);
+		expect(pass.overrunCount).to.equal(overrunCount);
+		expect(overruns).to.equal(0);
+	});
+
+	it(@"should display everything when asked to, regardless of the budget", ^{
+		pass.frameBudget = 0.001;
+		for (TUIView *view in [NSArray arrayWithObjects:a, b, c, d, nil])
+			[pass setNeedsDisplayForView:view];
+		[pass displayPendingViews];
+
+		expect([displayed count]).to.equal(4);
+		expect(pass.pendingViewCount).to.equal(0);
+	});
+});
+
+SpecEnd
@@ -0,0 +1,183 @@
+//
+//  TUIDrawSchedulerSpec.m
+//  TwUITests
+//
+
+#import "TUIDrawScheduler.h"
+
+// Draws run on a background queue and commit from the main display's frame
+// clock, so specs spin the main run loop until the results are in.
+static BOOL runMainLoopUntil(BOOL (^condition)(void)) {
+	NSDate *timeout = [NSDate dateWithTimeIntervalSinceNow:5.0];
+	while (!condition() && [timeout timeIntervalSinceNow] > 0)
+		[[NSRunLoop mainRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.01]];
+	return condition();
+}
+
+// Schedules a draw that notes when it ran and returns its name.
+static void scheduleNamedDraw(TUIDrawScheduler *scheduler, id owner, CGFloat priority, NSString *name, NSMutableArray *drawn, NSMutableArray *committed) {
+	[scheduler scheduleDrawForOwner:owner priority:^{
+		return priority;
+	} draw:^id{
+		@synchronized (drawn) {
+			[drawn addObject:name];
+		}
+		return name;
+	} commit:^(id result) {
+		[committed addObject:result];
+	} discard:nil];
+}
+
+SpecBegin(TUIDrawScheduler)
+
+__block TUIDrawScheduler *scheduler = nil;
+__block NSConditionLock *gate = nil;
+__block NSObject *blocker = nil;
+__block NSMutableArray *drawn = nil;
+__block NSMutableArray *committed = nil;
+
+beforeEach(^{
+	scheduler = [[TUIDrawScheduler alloc] init];
+	scheduler.maximumConcurrentDraws = 1;
+	drawn = [NSMutableArray array];
+	committed = [NSMutableArray array];
+
+	// holds the only slot until the gate opens, so later draws queue up
+	gate = [[NSConditionLock alloc] initWithCondition:0];
+	blocker = [[NSObject alloc] init];
+	[scheduler scheduleDrawForOwner:blocker priority:nil draw:^id{
+		[gate lockWhenCondition:1];
+		[gate unlock];
+		return @"blocker";
+	} commit:^(id result) {
+		[committed addObject:result];
+	} discard:nil];
+});
+
+afterEach(^{
+	// nothing may be left waiting on the gate
+	[gate lock];
+	[gate unlockWithCondition:1];
+	runMainLoopUntil(^{ return (BOOL)(scheduler.pendingDrawCount == 0); });
+});
+
+describe(@"ordering", ^{
+	it(@"should start queued draws highest priority first", ^{
+		NSObject *low = [[NSObject alloc] init];
+		NSObject *high = [[NSObject alloc] init];
+		NSObject *middle = [[NSObject alloc] init];
+		scheduleNamedDraw(scheduler, low, 1.0, @"low", drawn, committed);
+		scheduleNamedDraw(scheduler, high, 3.0, @"high", drawn, committed);
+		scheduleNamedDraw(scheduler, middle, 2.0, @"middle", drawn, committed);
+
+		[gate lock];
+		[gate unlockWithCondition:1];
+
+		expect(runMainLoopUntil(^{ return (BOOL)([committed count] == 4); })).to.beTruthy();
+		expect(drawn).to.equal([NSArray arrayWithObjects:@"high", @"middle", @"low", nil]);
+	});
+
+	it(@"should start draws of equal priority in the order they were scheduled", ^{
+		NSObject *first = [[NSObject alloc] init];
+		NSObject *second = [[NSObject alloc] init];
+		scheduleNamedDraw(scheduler, first, 1.0, @"first", drawn, committed);
+		scheduleNamedDraw(scheduler, second, 1.0, @"second", drawn, committed);
+
+		[gate lock];
+		[gate unlockWithCondition:1];
+
+		expect(runMainLoopUntil(^{ return (BOOL)([committed count] == 3); })).to.beTruthy();
+		expect(drawn).to.equal([NSArray arrayWithObjects:@"first", @"second", nil]);
+	});
+
+	it(@"should count draws as pending until they are committed", ^{
+		NSObject *owner = [[NSObject alloc] init];
+		scheduleNamedDraw(scheduler, owner, 1.0, @"queued", drawn, committed);
+		expect(scheduler.pendingDrawCount).to.equal(2);
+
+		[gate lock];
+		[gate unlockWithCondition:1];
+
+		expect(runMainLoopUntil(^{ return (BOOL)([committed count] == 2); })).to.beTruthy();
+		expect(scheduler.pendingDrawCount).to.equal(0);
+	});
+});
+
+describe(@"superseding", ^{
+	it(@"should replace a draw that hasn't started, discarding it", ^{
+		NSObject *owner = [[NSObject alloc] init];
+		__block BOOL discarded = NO;
+		[scheduler scheduleDrawForOwner:owner priority:nil draw:^id{
+			@synchronized (drawn) {
+				[drawn addObject:@"replaced"];
+			}
+			return @"replaced";
+		} commit:^(id result) {
+			[committed addObject:result];
+		} discard:^{
+			discarded = YES;
+		}];
+		scheduleNamedDraw(scheduler, owner, 0.0, @"replacement", drawn, committed);
+
+		expect(discarded).to.beTruthy();
+		expect(scheduler.pendingDrawCount).to.equal(2);
+
+		[gate lock];
+		[gate unlockWithCondition:1];
+
+		expect(runMainLoopUntil(^{ return (BOOL)([committed count] == 2); })).to.beTruthy();
+		expect(drawn).to.equal([NSArray arrayWithObject:@"replacement"]);
+		expect(committed).to.contain(@"replacement");
+		expect(committed).notTo.contain(@"replaced");
+	});
+
+	it(@"should throw away the result of a draw that had started", ^{
+		// the blocker is the draw that has started; it is rescheduled
+		scheduleNamedDraw(scheduler, blocker, 0.0, @"fresh", drawn, committed);
+
+		[gate lock];
+		[gate unlockWithCondition:1];
+
+		// the fresh draw only starts once the blocker has finished
+		expect(runMainLoopUntil(^{ return (BOOL)([committed count] == 1); })).to.beTruthy();
+		expect(committed).to.equal([NSArray arrayWithObject:@"fresh"]);
+	});
+
+	it(@"should discard a cancelled draw and never commit it", ^{
+		NSObject *owner = [[NSObject alloc] init];
+		__block BOOL discarded = NO;
+		[scheduler scheduleDrawForOwner:owner priority:nil draw:^id{
+			return @"cancelled";
+		} commit:^(id result) {
+			[committed addObject:result];
+		} discard:^{
+			discarded = YES;
+		}];
+		[scheduler cancelDrawForOwner:owner];
+
+		expect(discarded).to.beTruthy();
+		expect(scheduler.pendingDrawCount).to.equal(1);
+
+		[gate lock];
+		[gate unlockWithCondition:1];
+
+		expect(runMainLoopUntil(^{ return (BOOL)(scheduler.pendingDrawCount == 0); })).to.beTruthy();
+		expect(committed).to.equal([NSArray arrayWithObject:@"blocker"]);
+	});
+
+	it(@"should drop the result of a running draw that was cancelled", ^{
+		[scheduler cancelDrawForOwner:blocker];
+		expect(scheduler.pendingDrawCount).to.equal(0);
+
+		NSObject *owner = [[NSObject alloc] init];
+		scheduleNamedDraw(scheduler, owner, 0.0, @"after", drawn, committed);
+
+		[gate lock];
+		[gate unlockWithCondition:1];
+
+		expect(runMainLoopUntil(^{ return (BOOL)([committed count] == 1); })).to.beTruthy();
+		expect(committed).to.equal([NSArray arrayWithObject:@"after"]);
+	});
+});
+
+SpecEnd
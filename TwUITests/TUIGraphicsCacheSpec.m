@@ -0,0 +1,151 @@
+//
+//  TUIGraphicsCacheSpec.m
+//  TwUITests
+//
+
+#import "TUIGraphicsCache.h"
+
+// clear to opaque black
+static const CGFloat gradientComponents[] = {
+	0.0, 0.0, 0.0, 0.0,
+	0.0, 0.0, 0.0, 1.0,
+};
+
+SpecBegin(TUIGraphicsCache)
+
+__block TUIGraphicsCache *cache = nil;
+
+beforeEach(^{
+	cache = [[TUIGraphicsCache alloc] init];
+});
+
+describe(@"colors", ^{
+	it(@"should return the same color for the same components", ^{
+		CGFloat red[] = { 1.0, 0.0, 0.0, 1.0 };
+		CGFloat sameRed[] = { 1.0, 0.0, 0.0, 1.0 };
+		CGColorRef color = [cache colorWithColorSpace:TUIGetDeviceRGBColorSpace() components:red];
+
+		expect(color != NULL).to.beTruthy();
+		expect([cache colorWithColorSpace:TUIGetDeviceRGBColorSpace() components:sameRed] == color).to.beTruthy();
+	});
+
+	it(@"should key colors by every component, alpha included", ^{
+		CGFloat red[] = { 1.0, 0.0, 0.0, 1.0 };
+		CGFloat translucentRed[] = { 1.0, 0.0, 0.0, 0.5 };
+		CGColorRef color = [cache colorWithColorSpace:TUIGetDeviceRGBColorSpace() components:red];
+		CGColorRef translucent = [cache colorWithColorSpace:TUIGetDeviceRGBColorSpace() components:translucentRed];
+
+		expect(translucent != color).to.beTruthy();
+		expect(CGColorGetAlpha(translucent)).to.equal(0.5);
+	});
+
+	it(@"should key colors by color space", ^{
+		CGFloat white[] = { 1.0, 1.0, 1.0, 1.0 };
+		CGColorRef rgb = [cache colorWithColorSpace:TUIGetDeviceRGBColorSpace() components:white];
+		CGColorRef gray = [cache colorWithColorSpace:TUIGetDeviceGrayColorSpace() components:white];
+
+		expect(gray != rgb).to.beTruthy();
+		expect(CGColorGetNumberOfComponents(gray)).to.equal(2);
+	});
+
+	it(@"should remember the CGColor of an NSColor", ^{
+		NSColor *color = [NSColor colorWithDeviceRed:0.2 green:0.4 blue:0.6 alpha:1.0];
+		CGFloat components[] = { 0.2, 0.4, 0.6, 1.0 };
+		CGColorRef CGColor = [cache colorWithColorSpace:TUIGetDeviceRGBColorSpace() components:components];
+
+		expect([cache CGColorForColor:color] == NULL).to.beTruthy();
+		[cache setCGColor:CGColor forColor:color];
+		expect([cache CGColorForColor:color] == CGColor).to.beTruthy();
+	});
+
+	it(@"should never remember catalog colors", ^{
+		NSColor *color = [NSColor controlColor];
+		CGFloat components[] = { 0.9, 0.9, 0.9, 1.0 };
+		[cache setCGColor:[cache colorWithColorSpace:TUIGetDeviceRGBColorSpace() components:components] forColor:color];
+
+		expect([cache CGColorForColor:color] == NULL).to.beTruthy();
+	});
+
+	it(@"should remember pattern colors by image", ^{
+		NSImage *image = [[NSImage alloc] initWithSize:NSMakeSize(4, 4)];
+		NSImage *otherImage = [[NSImage alloc] initWithSize:NSMakeSize(4, 4)];
+		CGFloat components[] = { 0.0, 0.0, 0.0, 1.0 };
+		CGColorRef CGColor = [cache colorWithColorSpace:TUIGetDeviceRGBColorSpace() components:components];
+
+		[cache setCGColor:CGColor forPatternImage:image];
+		expect([cache CGColorForPatternImage:image] == CGColor).to.beTruthy();
+		expect([cache CGColorForPatternImage:otherImage] == NULL).to.beTruthy();
+	});
+});
+
+describe(@"gradients", ^{
+	it(@"should return the same gradient for the same stops", ^{
+		CGFloat locations[] = { 0.0, 1.0 };
+		CGGradientRef gradient = [cache gradientWithColorComponents:gradientComponents locations:locations count:2];
+
+		expect(gradient != NULL).to.beTruthy();
+		expect([cache gradientWithColorComponents:gradientComponents locations:locations count:2] == gradient).to.beTruthy();
+	});
+
+	it(@"should key gradients by their locations", ^{
+		CGFloat locations[] = { 0.0, 1.0 };
+		CGFloat otherLocations[] = { 0.25, 1.0 };
+		CGGradientRef gradient = [cache gradientWithColorComponents:gradientComponents locations:locations count:2];
+
+		expect([cache gradientWithColorComponents:gradientComponents locations:otherLocations count:2] != gradient).to.beTruthy();
+		expect([cache gradientWithColorComponents:gradientComponents locations:NULL count:2] != gradient).to.beTruthy();
+	});
+
+	it(@"should key gradients by their colors", ^{
+		CGFloat otherComponents[] = {
+			1.0, 1.0, 1.0, 0.0,
+			0.0, 0.0, 0.0, 1.0,
+		};
+		CGGradientRef gradient = [cache gradientWithColorComponents:gradientComponents locations:NULL count:2];
+
+		expect([cache gradientWithColorComponents:otherComponents locations:NULL count:2] != gradient).to.beTruthy();
+	});
+});
+
+describe(@"rounded rects", ^{
+	it(@"should return the same path for the same size, radius and corners", ^{
+		CGPathRef path = [cache roundedRectPathWithSize:CGSizeMake(40, 20) radius:5 corners:TUICGRoundedRectCornerAll];
+
+		expect([cache roundedRectPathWithSize:CGSizeMake(40, 20) radius:5 corners:TUICGRoundedRectCornerAll] == path).to.beTruthy();
+		expect(CGRectEqualToRect(CGPathGetBoundingBox(path), CGRectMake(0, 0, 40, 20))).to.beTruthy();
+	});
+
+	it(@"should key paths by size, radius and corners", ^{
+		CGPathRef path = [cache roundedRectPathWithSize:CGSizeMake(40, 20) radius:5 corners:TUICGRoundedRectCornerAll];
+
+		expect([cache roundedRectPathWithSize:CGSizeMake(40, 21) radius:5 corners:TUICGRoundedRectCornerAll] != path).to.beTruthy();
+		expect([cache roundedRectPathWithSize:CGSizeMake(40, 20) radius:6 corners:TUICGRoundedRectCornerAll] != path).to.beTruthy();
+		expect([cache roundedRectPathWithSize:CGSizeMake(40, 20) radius:5 corners:TUICGRoundedRectCornerTop] != path).to.beTruthy();
+	});
+});
+
+describe(@"eviction", ^{
+	it(@"should forget everything when emptied", ^{
+		NSColor *color = [NSColor colorWithDeviceWhite:0.5 alpha:1.0];
+		CGFloat components[] = { 0.5, 0.5, 0.5, 1.0 };
+		[cache setCGColor:[cache colorWithColorSpace:TUIGetDeviceRGBColorSpace() components:components] forColor:color];
+
+		[cache removeAllObjects];
+		expect([cache CGColorForColor:color] == NULL).to.beTruthy();
+	});
+
+	it(@"should keep returned objects alive until the autorelease pool drains", ^{
+		@autoreleasepool {
+			CGGradientRef gradient = [cache gradientWithColorComponents:gradientComponents locations:NULL count:2];
+			[cache removeAllObjects];
+			expect(gradient != NULL).to.beTruthy();
+
+			// evicted, but still valid to draw with
+			CGContextRef context = TUICreateGraphicsContext(CGSizeMake(4, 4));
+			CGContextDrawLinearGradient(context, gradient, CGPointZero, CGPointMake(4, 0), 0);
+			CGContextRelease(context);
+		}
+	});
+});
+
+SpecEnd
@@ -0,0 +1,176 @@
+//
+//  TUIScrollPhysicsSpec.m
+//  TwUITests
+//
+
+#import "TUIScrollPhysics.h"
+#import <mach/mach_time.h>
+
+static const double timestep = 1.0 / 60.0;
+
+static TUIScrollPhysics physicsWithBounds(double minimumY, double maximumY) {
+	TUIScrollPhysics physics;
+	TUIScrollPhysicsInit(&physics, TUIScrollPhysicsDefaultParameters());
+	TUIScrollPhysicsSetBounds(&physics, TUIScrollPhysicsVectorMake(0, minimumY), TUIScrollPhysicsVectorMake(0, maximumY));
+	return physics;
+}
+
+// Benchmarks only measure, and only report when TUIRunBenchmarks is set in
+// the environment; wall-clock time is too noisy to assert on.
+static void reportBenchmark(NSString *name, int iterations, uint64_t start, uint64_t end) {
+	if (!getenv("TUIRunBenchmarks"))
+		return;
+
+	mach_timebase_info_data_t timebase;
+	mach_timebase_info(&timebase);
+	double seconds = (double)(end - start) * timebase.numer / timebase.denom / 1e9;
+	printf("TUIScrollPhysics benchmark: %s, %d iterations in %.1fms (%.3fus each)\n", [name UTF8String], iterations, seconds * 1000.0, seconds * 1e6 / iterations);
+}
+
+static double runToRest(TUIScrollPhysics *physics, double start, double interval) {
+	double t = start;
+	while (TUIScrollPhysicsAdvance(physics, t) && t - start < 30.0)
+		t += interval;
+	return t - start;
+}
+
+SpecBegin(TUIScrollPhysics)
+
+describe(@"throwing", ^{
+	it(@"should come to rest where it predicted", ^{
+		TUIScrollPhysics physics = physicsWithBounds(-10000, 0);
+		TUIScrollPhysicsBeginThrow(&physics, TUIScrollPhysicsVectorMake(0, -1000), TUIScrollPhysicsVectorMake(0, -2000), TUIScrollPhysicsVectorMake(0, 0), 0);
+
+		TUIScrollPhysicsVector predicted = TUIScrollPhysicsPredictedRestingOffset(&physics);
+		runToRest(&physics, 0, timestep);
+
+		expect(fabs(predicted.y - physics.y.offset) < 0.05).to.beTruthy();
+		expect(TUIScrollPhysicsIsAnimating(&physics)).to.beFalsy();
+	});
+
+	it(@"should land on a new target when retargeted", ^{
+		TUIScrollPhysics physics = physicsWithBounds(-10000, 0);
+		TUIScrollPhysicsBeginThrow(&physics, TUIScrollPhysicsVectorMake(0, -1000), TUIScrollPhysicsVectorMake(0, -2000), TUIScrollPhysicsVectorMake(0, 0), 0);
+		TUIScrollPhysicsRetargetThrow(&physics, TUIScrollPhysicsVectorMake(0, -1500));
+
+		expect(TUIScrollPhysicsPredictedRestingOffset(&physics).y).to.equal(-1500.0);
+
+		runToRest(&physics, 0, timestep);
+		expect(fabs(physics.y.offset + 1500.0) < 0.05).to.beTruthy();
+	});
+
+	it(@"should follow the same trajectory however often it is sampled", ^{
+		TUIScrollPhysics a = physicsWithBounds(-10000, 0);
+		TUIScrollPhysicsBeginThrow(&a, TUIScrollPhysicsVectorMake(0, -1000), TUIScrollPhysicsVectorMake(0, 3000), TUIScrollPhysicsVectorMake(0, 0), 0);
+		TUIScrollPhysics b = a;
+
+		TUIScrollPhysicsAdvance(&a, 0.5);
+		for (double t = 0; t <= 0.5; t += 0.037)
+			TUIScrollPhysicsAdvance(&b, t);
+		TUIScrollPhysicsAdvance(&b, 0.5);
+
+		TUIScrollPhysicsVector sampleA = TUIScrollPhysicsOffsetAtTime(&a, 0.51);
+		TUIScrollPhysicsVector sampleB = TUIScrollPhysicsOffsetAtTime(&b, 0.51);
+		expect(sampleA.y).to.equal(sampleB.y);
+	});
+
+	it(@"should bounce off an edge and settle on it", ^{
+		TUIScrollPhysics physics = physicsWithBounds(-1000, 0);
+		TUIScrollPhysicsBeginThrow(&physics, TUIScrollPhysicsVectorMake(0, -100), TUIScrollPhysicsVectorMake(0, 3000), TUIScrollPhysicsVectorMake(0, 0), 0);
+
+		BOOL bounced = NO;
+		for (double t = 0; TUIScrollPhysicsAdvance(&physics, t); t += timestep) {
+			bounced |= TUIScrollPhysicsIsBouncing(&physics);
+			expect(physics.y.offset <= 0.0).to.beTruthy();
+		}
+
+		expect(bounced).to.beTruthy();
+		expect(physics.y.offset).to.equal(0.0);
+		expect(physics.y.bounce).to.equal(0.0);
+	});
+
+	it(@"should stop at the edge without bouncing when bouncing is off", ^{
+		TUIScrollPhysics physics = physicsWithBounds(-1000, 0);
+		physics.parameters.bounces = false;
+		TUIScrollPhysicsBeginThrow(&physics, TUIScrollPhysicsVectorMake(0, -100), TUIScrollPhysicsVectorMake(0, 3000), TUIScrollPhysicsVectorMake(0, 0), 0);
+
+		double duration = runToRest(&physics, 0, timestep);
+		expect(duration < 0.2).to.beTruthy();
+		expect(physics.y.offset).to.equal(0.0);
+	});
+
+	it(@"should spring back from a pull", ^{
+		TUIScrollPhysics physics = physicsWithBounds(-1000, 0);
+		TUIScrollPhysicsBeginThrow(&physics, TUIScrollPhysicsVectorMake(0, 0), TUIScrollPhysicsVectorMake(0, 500), TUIScrollPhysicsVectorMake(0, 40), 0);
+
+		expect(physics.y.velocity).to.equal(0.0);
+		expect(TUIScrollPhysicsOffsetAtTime(&physics, 0.1).y < 40.0).to.beTruthy();
+
+		runToRest(&physics, 0, timestep);
+		expect(physics.y.bounce).to.equal(0.0);
+	});
+});
+
+describe(@"scrolling to an offset", ^{
+	it(@"should ease into the destination and land on it exactly", ^{
+		TUIScrollPhysics physics = physicsWithBounds(-1000, 0);
+		TUIScrollPhysicsBeginScrollTo(&physics, TUIScrollPhysicsVectorMake(0, 0), TUIScrollPhysicsVectorMake(0, -800), 0);
+
+		expect(TUIScrollPhysicsPredictedRestingOffset(&physics).y).to.equal(-800.0);
+
+		double early = TUIScrollPhysicsOffsetAtTime(&physics, 0.1).y;
+		expect(early < 0.0 && early > -800.0).to.beTruthy();
+
+		runToRest(&physics, 0, timestep);
+		expect(physics.y.offset).to.equal(-800.0);
+	});
+
+	it(@"should stop at the edge when the destination is out of bounds", ^{
+		TUIScrollPhysics physics = physicsWithBounds(-1000, 0);
+		TUIScrollPhysicsBeginScrollTo(&physics, TUIScrollPhysicsVectorMake(0, 0), TUIScrollPhysicsVectorMake(0, -5000), 0);
+
+		expect(TUIScrollPhysicsPredictedRestingOffset(&physics).y).to.equal(-1000.0);
+
+		runToRest(&physics, 0, timestep);
+		expect(physics.y.offset).to.equal(-1000.0);
+	});
+});
+
+describe(@"many throws", ^{
+	it(@"should each come to rest inside the bounds", ^{
+		for (int i = 0; i < 1000; i++) {
+			TUIScrollPhysics physics = physicsWithBounds(-100000, 0);
+			TUIScrollPhysicsBeginThrow(&physics, TUIScrollPhysicsVectorMake(0, -50000), TUIScrollPhysicsVectorMake(0, (i % 2 ? 1 : -1) * (500.0 + i)), TUIScrollPhysicsVectorMake(0, 0), 0);
+
+			expect(runToRest(&physics, 0, timestep) < 30.0).to.beTruthy();
+			expect(physics.y.offset >= -100000.0 && physics.y.offset <= 0.0).to.beTruthy();
+		}
+	});
+});
+
+describe(@"benchmark", ^{
+	it(@"should simulate throws to rest", ^{
+		const int iterations = 10000;
+		uint64_t start = mach_absolute_time();
+		for (int i = 0; i < iterations; i++) {
+			TUIScrollPhysics physics = physicsWithBounds(-100000, 0);
+			TUIScrollPhysicsBeginThrow(&physics, TUIScrollPhysicsVectorMake(0, -50000), TUIScrollPhysicsVectorMake(0, (i % 2 ? 1 : -1) * (500.0 + i)), TUIScrollPhysicsVectorMake(0, 0), 0);
+			runToRest(&physics, 0, timestep);
+		}
+		reportBenchmark(@"throw to rest", iterations, start, mach_absolute_time());
+	});
+
+	it(@"should sample a throw", ^{
+		const int iterations = 100000;
+		TUIScrollPhysics physics = physicsWithBounds(-100000, 0);
+		TUIScrollPhysicsBeginThrow(&physics, TUIScrollPhysicsVectorMake(0, -50000), TUIScrollPhysicsVectorMake(0, 5000), TUIScrollPhysicsVectorMake(0, 0), 0);
+
+		TUIScrollPhysicsVector offset, bounce;
+		uint64_t start = mach_absolute_time();
+		for (int i = 0; i < iterations; i++)
+			TUIScrollPhysicsSample(&physics, timestep * (i % 100) / 100.0, &offset, &bounce);
+		reportBenchmark(@"sample", iterations, start, mach_absolute_time());
+	});
+});
+
+SpecEnd
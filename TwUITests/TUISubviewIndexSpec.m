@@ -0,0 +1,163 @@
+//
+//  TUISubviewIndexSpec.m
+//  TwUITests
+//
+
+#import "TUISubviewIndex.h"
+#import "TUIView.h"
+
+// Adds a subview the way TUIView does, telling the index afterwards.
+static TUIView *addSubview(TUIView *view, TUISubviewIndex *subviewIndex, CGRect frame) {
+	TUIView *subview = [[TUIView alloc] initWithFrame:frame];
+	[view addSubview:subview];
+	[subviewIndex didInsertSubview:subview];
+	return subview;
+}
+
+SpecBegin(TUISubviewIndex)
+
+__block TUIView *view = nil;
+__block TUISubviewIndex *subviewIndex = nil;
+
+beforeEach(^{
+	view = [[TUIView alloc] initWithFrame:CGRectMake(0, 0, 1000, 1000)];
+	subviewIndex = [[TUISubviewIndex alloc] initWithView:view];
+});
+
+describe(@"ordering", ^{
+	it(@"should keep subviews in subviews order at the same zPosition", ^{
+		TUIView *a = addSubview(view, subviewIndex, CGRectMake(0, 0, 10, 10));
+		TUIView *b = addSubview(view, subviewIndex, CGRectMake(0, 0, 10, 10));
+		TUIView *c = addSubview(view, subviewIndex, CGRectMake(0, 0, 10, 10));
+
+		expect([subviewIndex sortedSubviews]).to.equal([NSArray arrayWithObjects:a, b, c, nil]);
+	});
+
+	it(@"should put higher zPositions in front", ^{
+		TUIView *a = addSubview(view, subviewIndex, CGRectMake(0, 0, 10, 10));
+		TUIView *b = addSubview(view, subviewIndex, CGRectMake(0, 0, 10, 10));
+		TUIView *c = addSubview(view, subviewIndex, CGRectMake(0, 0, 10, 10));
+		[subviewIndex sortedSubviews];
+
+		a.zPosition = 1.0;
+		[subviewIndex subviewZPositionDidChange];
+		expect([subviewIndex sortedSubviews]).to.equal([NSArray arrayWithObjects:b, c, a, nil]);
+
+		c.zPosition = -1.0;
+		[subviewIndex subviewZPositionDidChange];
+		expect([subviewIndex sortedSubviews]).to.equal([NSArray arrayWithObjects:c, b, a, nil]);
+	});
+
+	it(@"should place inserted subviews within their zPosition", ^{
+		TUIView *a = addSubview(view, subviewIndex, CGRectMake(0, 0, 10, 10));
+		TUIView *front = addSubview(view, subviewIndex, CGRectMake(0, 0, 10, 10));
+		front.zPosition = 1.0;
+		[subviewIndex subviewZPositionDidChange];
+		[subviewIndex sortedSubviews];
+
+		// at the end of the array, and at the start
+		TUIView *b = addSubview(view, subviewIndex, CGRectMake(0, 0, 10, 10));
+		TUIView *first = [[TUIView alloc] initWithFrame:CGRectMake(0, 0, 10, 10)];
+		[view insertSubview:first atIndex:0];
+		[subviewIndex didInsertSubview:first];
+		expect([subviewIndex sortedSubviews]).to.equal([NSArray arrayWithObjects:first, a, b, front, nil]);
+
+		// anywhere else, by sorting again
+		TUIView *middle = [[TUIView alloc] initWithFrame:CGRectMake(0, 0, 10, 10)];
+		[view insertSubview:middle aboveSubview:a];
+		[subviewIndex didInsertSubview:middle];
+		expect([subviewIndex sortedSubviews]).to.equal([NSArray arrayWithObjects:first, a, middle, b, front, nil]);
+	});
+
+	it(@"should drop removed subviews", ^{
+		TUIView *a = addSubview(view, subviewIndex, CGRectMake(0, 0, 10, 10));
+		TUIView *b = addSubview(view, subviewIndex, CGRectMake(0, 0, 10, 10));
+		TUIView *c = addSubview(view, subviewIndex, CGRectMake(0, 0, 10, 10));
+		[subviewIndex sortedSubviews];
+
+		[b removeFromSuperview];
+		[subviewIndex didRemoveSubview:b];
+		expect([subviewIndex sortedSubviews]).to.equal([NSArray arrayWithObjects:a, c, nil]);
+	});
+});
+
+describe(@"grid", ^{
+	__block NSMutableArray *tiles = nil;
+
+	beforeEach(^{
+		subviewIndex.usesSpatialIndex = YES;
+
+		// a 10x10 board of 100pt tiles, and one tile over all of it
+		tiles = [NSMutableArray array];
+		for (int row = 0; row < 10; row++) {
+			for (int column = 0; column < 10; column++)
+				[tiles addObject:addSubview(view, subviewIndex, CGRectMake(column * 100, row * 100, 100, 100))];
+		}
+		[tiles addObject:addSubview(view, subviewIndex, CGRectMake(0, 0, 1000, 1000))];
+	});
+
+	it(@"should return every subview containing the point, back to front", ^{
+		CGPoint points[] = { {50, 50}, {150, 150}, {450, 650}, {999, 999}, {200, 200} };
+		for (size_t p = 0; p < sizeof(points) / sizeof(points[0]); p++) {
+			NSArray *candidates = [subviewIndex sortedSubviewsAtPoint:points[p]];
+
+			for (TUIView *tile in tiles) {
+				if (CGRectContainsPoint(tile.frame, points[p]))
+					expect(candidates).to.contain(tile);
+			}
+
+			NSArray *sorted = [subviewIndex sortedSubviews];
+			NSUInteger last = 0;
+			for (TUIView *candidate in candidates) {
+				NSUInteger i = [sorted indexOfObjectIdenticalTo:candidate];
+				expect(i >= last).to.beTruthy();
+				last = i;
+			}
+		}
+	});
+
+	it(@"should leave out subviews far from the point", ^{
+		NSArray *candidates = [subviewIndex sortedSubviewsAtPoint:CGPointMake(50, 50)];
+		expect([candidates count] < [tiles count]).to.beTruthy();
+		expect(candidates).notTo.contain([tiles objectAtIndex:99]);
+	});
+
+	it(@"should return nothing outside every subview", ^{
+		expect([[subviewIndex sortedSubviewsAtPoint:CGPointMake(-10, -10)] count]).to.equal(0);
+		expect([[subviewIndex sortedSubviewsAtPoint:CGPointMake(1500, 500)] count]).to.equal(0);
+	});
+
+	it(@"should rebuild when told subviews moved", ^{
+		TUIView *tile = [tiles objectAtIndex:0];
+		[subviewIndex sortedSubviewsAtPoint:CGPointMake(50, 50)];
+
+		tile.layer.frame = CGRectMake(850, 850, 100, 100);
+		[subviewIndex subviewGeometryDidChange];
+
+		expect([subviewIndex sortedSubviewsAtPoint:CGPointMake(900, 900)]).to.contain(tile);
+		expect([subviewIndex sortedSubviewsAtPoint:CGPointMake(50, 50)]).notTo.contain(tile);
+	});
+
+	it(@"should rebuild when a subview in the cell moved behind its back", ^{
+		TUIView *tile = [tiles objectAtIndex:0];
+		[subviewIndex sortedSubviewsAtPoint:CGPointMake(50, 50)];
+
+		// as Core Animation's autoresizing would, without telling the index
+		tile.layer.frame = CGRectMake(850, 850, 100, 100);
+
+		expect([subviewIndex sortedSubviewsAtPoint:CGPointMake(50, 50)]).notTo.contain(tile);
+		expect([subviewIndex sortedSubviewsAtPoint:CGPointMake(900, 900)]).to.contain(tile);
+	});
+
+	it(@"should rebuild when the order changes", ^{
+		TUIView *tile = [tiles objectAtIndex:0];
+		TUIView *cover = [tiles lastObject];
+		expect([[subviewIndex sortedSubviewsAtPoint:CGPointMake(50, 50)] lastObject]).to.equal(cover);
+
+		tile.zPosition = 1.0;
+		[subviewIndex subviewZPositionDidChange];
+		expect([[subviewIndex sortedSubviewsAtPoint:CGPointMake(50, 50)] lastObject]).to.equal(tile);
+	});
+});
+
+SpecEnd
@@ -7,6 +7,7 @@
 
 #import "NSColor+TUIExtensions.h"
 #import "NSImage+TUIExtensions.h"
+#import "TUIGraphicsCache.h"
 
 // CGPatterns involve some complex memory management which doesn't mesh well
 // with ARC.
@@ -43,7 +44,13 @@ static void releasePatternInfo (void *info) {
 }
 
 - (CGColorRef)tui_CGColor; {
+    TUIGraphicsCache *cache = [TUIGraphicsCache sharedCache];
+
     if ([self.colorSpaceName isEqualToString:NSPatternColorSpace]) {
+        CGColorRef cached = [cache CGColorForPatternImage:self.patternImage];
+        if (cached)
+            return cached;
+
         CGImageRef patternImage = self.patternImage.tui_CGImage;
         if (!patternImage)
             return NULL;
@@ -74,9 +81,14 @@ static void releasePatternInfo (void *info) {
         CGColorSpaceRelease(colorSpaceRef);
         CGPatternRelease(pattern);
 
+        [cache setCGColor:result forPatternImage:self.patternImage];
         return (CGColorRef)[(id)result autorelease];
     }
 
+    CGColorRef cached = [cache CGColorForColor:self];
+    if (cached)
+        return cached;
+
     NSColorSpace *colorSpace = [NSColorSpace genericRGBColorSpace];
     NSColor *color = [self colorUsingColorSpace:colorSpace];
 
@@ -84,10 +96,10 @@ static void releasePatternInfo (void *info) {
     CGFloat components[count];
     [color getComponents:components];
 
-    CGColorSpaceRef colorSpaceRef = colorSpace.CGColorSpace;
-    CGColorRef result = CGColorCreate(colorSpaceRef, components);
+    CGColorRef result = [cache colorWithColorSpace:colorSpace.CGColorSpace components:components];
+    [cache setCGColor:result forColor:self];
 
-    return (CGColorRef)[(id)result autorelease];
+    return result;
 }
 
 @end
@@ -0,0 +1,91 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+#import <ApplicationServices/ApplicationServices.h>
+
+// Pixel formats a backing store can have. Smaller formats take less memory
+// and are cheaper to upload, but only suit some content: colour drawn into
+// a gray store comes out gray, and an alpha-only store keeps nothing but
+// coverage, so it shows as black wherever something was drawn.
+typedef enum {
+	TUIBackingStoreFormatARGB32,	// 32 bits per pixel device RGB
+	TUIBackingStoreFormatRGB16,	// 16 bits per pixel device RGB, opaque only
+	TUIBackingStoreFormatGray8,	// 8 bits per pixel device gray, opaque only
+	TUIBackingStoreFormatAlpha8,	// 8 bits per pixel alpha only
+} TUIBackingStoreFormat;
+
+// A TUIBackingStorePool recycles the pixel buffers behind the bitmap
+// contexts views draw into, so resizing windows and recycling table cells
+// of varying sizes reuse memory instead of going back to malloc for every
+// new backing store.
+//
+// Buffers are bucketed by byte size: pixel size rounded up to a multiple of
+// 32 in each dimension, so the scale factor is folded in, times bytes per
+// pixel. Contexts of any format share buckets.
+// A context created by the pool borrows a buffer; when the context is
+// released its buffer goes back to the pool, where it waits for the next
+// context of the same bucket. Idle buffers beyond byteBudget are freed,
+// oldest first.
+//
+// Pooled contexts come back cleared, just like freshly allocated ones. The
+// pool is safe to use from any thread.
+@interface TUIBackingStorePool : NSObject
+
+// The pool used by TUICreateGraphicsContext() and friends.
++ (TUIBackingStorePool *)sharedPool;
+
+// Bytes of idle buffers the pool may hold on to. Default 32MB. Lowering
+// it frees the oldest idle buffers until the pool fits.
+@property (nonatomic, assign) NSUInteger byteBudget;
+
+// Bytes of idle buffers currently held.
+@property (nonatomic, readonly) NSUInteger bytesHeld;
+
+// Bytes of buffers currently lent out to live contexts.
+@property (nonatomic, readonly) NSUInteger bytesInUse;
+
+// Number of contexts created from a recycled buffer, and from a new one.
+@property (nonatomic, readonly) NSUInteger hitCount;
+@property (nonatomic, readonly) NSUInteger missCount;
+
+// Returns a new 8 bits per component, 32 bits per pixel device RGB bitmap
+// context of the given size in pixels, with (opaque) or without an alpha
+// channel. The caller owns the context and releases it as usual.
+- (CGContextRef)createContextWithPixelSize:(CGSize)size opaque:(BOOL)opaque CF_RETURNS_RETAINED;
+
+// Like -createContextWithPixelSize:opaque:, in the given format. Formats
+// that can only be opaque fall back to TUIBackingStoreFormatARGB32 for
+// contexts that are not.
+- (CGContextRef)createContextWithPixelSize:(CGSize)size format:(TUIBackingStoreFormat)format opaque:(BOOL)opaque CF_RETURNS_RETAINED;
+
+// Returns an image of the context's current pixels that shares the
+// context's buffer instead of copying it, and releases the context. The
+// buffer goes back to the pool once the image is freed; nothing draws into
+// it in the meantime, which is what makes sharing it safe. Contexts that
+// didn't come from a pool are copied and released as usual.
+- (CGImageRef)createImageByDetachingContext:(CGContextRef)context CF_RETURNS_RETAINED;
+
+// Copies the pixels of an image returned by
+// -createImageByDetachingContext: into a context of the same size and
+// format with a single memcpy, for redrawing part of an image on top of
+// the rest of it. Returns NO, copying nothing, for any other image.
+- (BOOL)copyPixelsOfImage:(CGImageRef)image toContext:(CGContextRef)context;
+
+// Frees every idle buffer.
+- (void)purge;
+
+@end
@@ -0,0 +1,419 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import "TUIBackingStorePool.h"
+#import "TUICGAdditions.h"
+#import <libkern/OSAtomic.h>
+
+#define TUIBackingStoreBucketGranularity 32
+
+typedef struct TUIBackingStoreBuffer {
+	void *data;
+	size_t capacity;
+	void *pool; // unretained, pools live as long as their buffers
+	volatile int32_t references; // a context and/or the images detached from it
+	CGImageRef image; // unretained, the image detached from it, if any
+	CGDataProviderRef provider; // unretained, that image's provider
+
+	// while idle: neighbours among every idle buffer, and among the idle
+	// buffers of the same capacity
+	struct TUIBackingStoreBuffer *idleOlder, *idleNewer;
+	struct TUIBackingStoreBuffer *bucketOlder, *bucketNewer;
+} TUIBackingStoreBuffer;
+
+// Idle buffers, kept in plain C so no objects are created or messaged
+// under the pool's lock.
+typedef struct {
+	// capacity -> the most recently returned idle buffer of that capacity
+	CFMutableDictionaryRef newestByCapacity;
+	TUIBackingStoreBuffer *oldest;
+	TUIBackingStoreBuffer *newest;
+} TUIBackingStoreIdleList;
+
+@interface TUIBackingStorePool () {
+	OSSpinLock _lock;
+
+	TUIBackingStoreIdleList _idle;
+	// data pointer -> buffer, for buffers lent out to contexts
+	CFMutableDictionaryRef _buffersInUse;
+	// image -> buffer, for images detached from contexts
+	CFMutableDictionaryRef _detachedImages;
+}
+
+- (TUIBackingStoreBuffer *)_takeBufferWithCapacity:(size_t)capacity;
+- (void)_returnBuffer:(TUIBackingStoreBuffer *)buffer;
+
+@end
+
+static void TUIBackingStoreIdleListAdd(TUIBackingStoreIdleList *list, TUIBackingStoreBuffer *buffer)
+{
+	const void *key = (const void *)buffer->capacity;
+	TUIBackingStoreBuffer *bucketNewest = (TUIBackingStoreBuffer *)CFDictionaryGetValue(list->newestByCapacity, key);
+	buffer->bucketOlder = bucketNewest;
+	buffer->bucketNewer = NULL;
+	if (bucketNewest)
+		bucketNewest->bucketNewer = buffer;
+	CFDictionarySetValue(list->newestByCapacity, key, buffer);
+
+	buffer->idleOlder = list->newest;
+	buffer->idleNewer = NULL;
+	if (list->newest)
+		list->newest->idleNewer = buffer;
+	else
+		list->oldest = buffer;
+	list->newest = buffer;
+}
+
+static void TUIBackingStoreIdleListRemove(TUIBackingStoreIdleList *list, TUIBackingStoreBuffer *buffer)
+{
+	if (buffer->bucketNewer) {
+		buffer->bucketNewer->bucketOlder = buffer->bucketOlder;
+	} else {
+		const void *key = (const void *)buffer->capacity;
+		if (buffer->bucketOlder)
+			CFDictionarySetValue(list->newestByCapacity, key, buffer->bucketOlder);
+		else
+			CFDictionaryRemoveValue(list->newestByCapacity, key);
+	}
+	if (buffer->bucketOlder)
+		buffer->bucketOlder->bucketNewer = buffer->bucketNewer;
+
+	if (buffer->idleNewer)
+		buffer->idleNewer->idleOlder = buffer->idleOlder;
+	else
+		list->newest = buffer->idleOlder;
+	if (buffer->idleOlder)
+		buffer->idleOlder->idleNewer = buffer->idleNewer;
+	else
+		list->oldest = buffer->idleNewer;
+
+	buffer->idleOlder = buffer->idleNewer = NULL;
+	buffer->bucketOlder = buffer->bucketNewer = NULL;
+}
+
+/**
+ * @internal
+ * @brief Unlink idle buffers, oldest first, until at most budget bytes are held
+ * @return The unlinked buffers chained through idleNewer, to be freed once unlocked
+ */
+static TUIBackingStoreBuffer *TUIBackingStoreIdleListEvict(TUIBackingStoreIdleList *list, NSUInteger *bytesHeld, NSUInteger budget)
+{
+	TUIBackingStoreBuffer *evicted = NULL;
+	while (*bytesHeld > budget && list->oldest) {
+		TUIBackingStoreBuffer *b = list->oldest;
+		TUIBackingStoreIdleListRemove(list, b);
+		*bytesHeld -= b->capacity;
+		b->idleNewer = evicted;
+		evicted = b;
+	}
+	return evicted;
+}
+
+/**
+ * @internal
+ * @brief Free a chain of buffers linked through idleNewer
+ */
+static void TUIBackingStoreBufferFreeChain(TUIBackingStoreBuffer *buffer)
+{
+	while (buffer) {
+		TUIBackingStoreBuffer *next = buffer->idleNewer;
+		free(buffer->data);
+		free(buffer);
+		buffer = next;
+	}
+}
+
+@implementation TUIBackingStorePool
+
+@synthesize byteBudget = _byteBudget;
+@synthesize bytesHeld = _bytesHeld;
+@synthesize bytesInUse = _bytesInUse;
+@synthesize hitCount = _hitCount;
+@synthesize missCount = _missCount;
+
++ (TUIBackingStorePool *)sharedPool
+{
+	static TUIBackingStorePool *sharedPool = nil;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		sharedPool = [[TUIBackingStorePool alloc] init];
+	});
+	return sharedPool;
+}
+
+- (id)init
+{
+	if ((self = [super init])) {
+		_lock = OS_SPINLOCK_INIT;
+		_byteBudget = 32 * 1024 * 1024;
+		_idle.newestByCapacity = CFDictionaryCreateMutable(NULL, 0, NULL, NULL);
+		_buffersInUse = CFDictionaryCreateMutable(NULL, 0, NULL, NULL);
+		_detachedImages = CFDictionaryCreateMutable(NULL, 0, NULL, NULL);
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[self purge];
+	CFRelease(_buffersInUse);
+	CFRelease(_detachedImages);
+	CFRelease(_idle.newestByCapacity);
+}
+
+static void TUIBackingStoreBufferRelease(void *releaseInfo, void *data)
+{
+	TUIBackingStoreBuffer *buffer = releaseInfo;
+	if (OSAtomicDecrement32Barrier(&buffer->references) == 0)
+		[(__bridge TUIBackingStorePool *)buffer->pool _returnBuffer:buffer];
+}
+
+static void TUIBackingStoreImageRelease(void *info, const void *data, size_t size)
+{
+	TUIBackingStoreBufferRelease(info, (void *)data);
+}
+
+- (CGContextRef)createContextWithPixelSize:(CGSize)size opaque:(BOOL)opaque
+{
+	return [self createContextWithPixelSize:size format:TUIBackingStoreFormatARGB32 opaque:opaque];
+}
+
+- (CGContextRef)createContextWithPixelSize:(CGSize)size format:(TUIBackingStoreFormat)format opaque:(BOOL)opaque
+{
+	if (!opaque && (format == TUIBackingStoreFormatRGB16 || format == TUIBackingStoreFormatGray8))
+		format = TUIBackingStoreFormatARGB32;
+
+	size_t bitsPerComponent = 8;
+	size_t bytesPerPixel = 4;
+	CGColorSpaceRef colorSpace = TUIGetDeviceRGBColorSpace();
+	CGBitmapInfo bitmapInfo = 0;
+	switch (format) {
+		case TUIBackingStoreFormatRGB16:
+			bitsPerComponent = 5;
+			bytesPerPixel = 2;
+			bitmapInfo = kCGBitmapByteOrder16Host | kCGImageAlphaNoneSkipFirst;
+			break;
+		case TUIBackingStoreFormatGray8:
+			bytesPerPixel = 1;
+			colorSpace = TUIGetDeviceGrayColorSpace();
+			bitmapInfo = kCGImageAlphaNone;
+			break;
+		case TUIBackingStoreFormatAlpha8:
+			bytesPerPixel = 1;
+			colorSpace = NULL;
+			bitmapInfo = kCGImageAlphaOnly;
+			break;
+		default:
+			// http://www.cocoabuilder.com/archive/cocoa/228931-sub-pixel-font-smoothing-with-cgbitmapcontext.html
+			// http://developer.apple.com/mac/library/qa/qa2001/qa1037.html
+			bitmapInfo = kCGBitmapByteOrder32Host | (opaque ? kCGImageAlphaNoneSkipFirst : kCGImageAlphaPremultipliedFirst);
+			break;
+	}
+
+	size_t width = MAX(1, (size_t)size.width);
+	size_t height = MAX(1, (size_t)size.height);
+	size_t bucketWidth = (width + TUIBackingStoreBucketGranularity - 1) / TUIBackingStoreBucketGranularity * TUIBackingStoreBucketGranularity;
+	size_t bucketHeight = (height + TUIBackingStoreBucketGranularity - 1) / TUIBackingStoreBucketGranularity * TUIBackingStoreBucketGranularity;
+	size_t bytesPerRow = bytesPerPixel * bucketWidth;
+
+	TUIBackingStoreBuffer *buffer = [self _takeBufferWithCapacity:bytesPerRow * bucketHeight];
+	if (!buffer)
+		return NULL;
+
+	buffer->references = 1;
+	CGContextRef ctx = CGBitmapContextCreateWithData(buffer->data, width, height, bitsPerComponent, bytesPerRow, colorSpace, bitmapInfo, TUIBackingStoreBufferRelease, buffer);
+	if (!ctx)
+		[self _returnBuffer:buffer];
+	return ctx;
+}
+
+- (CGImageRef)createImageByDetachingContext:(CGContextRef)context
+{
+	if (!context)
+		return NULL;
+
+	void *data = CGBitmapContextGetData(context);
+
+	OSSpinLockLock(&_lock);
+	TUIBackingStoreBuffer *buffer = (TUIBackingStoreBuffer *)CFDictionaryGetValue(_buffersInUse, data);
+	OSSpinLockUnlock(&_lock);
+
+	// an image can't be made over an alpha-only buffer without a color
+	// space, so those are copied out like contexts from anywhere else
+	CGColorSpaceRef colorSpace = CGBitmapContextGetColorSpace(context);
+	if (!buffer || !colorSpace) {
+		CGImageRef image = CGBitmapContextCreateImage(context);
+		CGContextRelease(context);
+		return image;
+	}
+
+	CGContextFlush(context);
+	OSAtomicIncrement32Barrier(&buffer->references);
+
+	size_t height = CGBitmapContextGetHeight(context);
+	size_t bytesPerRow = CGBitmapContextGetBytesPerRow(context);
+	CGDataProviderRef provider = CGDataProviderCreateWithData(buffer, buffer->data, bytesPerRow * height, TUIBackingStoreImageRelease);
+	CGImageRef image = CGImageCreate(CGBitmapContextGetWidth(context), height,
+									 CGBitmapContextGetBitsPerComponent(context), CGBitmapContextGetBitsPerPixel(context), bytesPerRow,
+									 colorSpace, CGBitmapContextGetBitmapInfo(context),
+									 provider, NULL, false, kCGRenderingIntentDefault);
+	CGDataProviderRelease(provider);
+
+	// anything else Quartz won't wrap still gets an image rather than none
+	BOOL detached = (image != NULL);
+	if (!detached)
+		image = CGBitmapContextCreateImage(context);
+	CGContextRelease(context);
+
+	if (detached) {
+		OSSpinLockLock(&_lock);
+		buffer->image = image;
+		buffer->provider = provider;
+		CFDictionarySetValue(_detachedImages, image, buffer);
+		OSSpinLockUnlock(&_lock);
+	}
+	return image;
+}
+
+- (BOOL)copyPixelsOfImage:(CGImageRef)image toContext:(CGContextRef)context
+{
+	if (!image || !context)
+		return NO;
+
+	size_t bytesPerRow = CGBitmapContextGetBytesPerRow(context);
+	size_t height = CGBitmapContextGetHeight(context);
+	if (CGImageGetWidth(image) != CGBitmapContextGetWidth(context) ||
+	   CGImageGetHeight(image) != height ||
+	   CGImageGetBytesPerRow(image) != bytesPerRow ||
+	   CGImageGetBitsPerPixel(image) != CGBitmapContextGetBitsPerPixel(context) ||
+	   CGImageGetBitmapInfo(image) != CGBitmapContextGetBitmapInfo(context))
+		return NO;
+
+	void *data = CGBitmapContextGetData(context);
+	if (!data)
+		return NO;
+
+	OSSpinLockLock(&_lock);
+	TUIBackingStoreBuffer *buffer = (TUIBackingStoreBuffer *)CFDictionaryGetValue(_detachedImages, image);
+	// an entry outlives its image for as long as someone else holds on to the
+	// provider, so make sure this is really the image it was recorded for
+	if (buffer && buffer->provider != CGImageGetDataProvider(image))
+		buffer = NULL;
+	// and that it isn't on its way back to the pool already
+	while (buffer) {
+		int32_t references = buffer->references;
+		if (references <= 0)
+			buffer = NULL;
+		else if (OSAtomicCompareAndSwap32Barrier(references, references + 1, &buffer->references))
+			break;
+	}
+	OSSpinLockUnlock(&_lock);
+
+	if (!buffer)
+		return NO;
+
+	memcpy(data, buffer->data, bytesPerRow * height);
+	TUIBackingStoreBufferRelease(buffer, buffer->data);
+	return YES;
+}
+
+- (TUIBackingStoreBuffer *)_takeBufferWithCapacity:(size_t)capacity
+{
+	OSSpinLockLock(&_lock);
+	TUIBackingStoreBuffer *buffer = (TUIBackingStoreBuffer *)CFDictionaryGetValue(_idle.newestByCapacity, (const void *)capacity);
+	if (buffer) {
+		TUIBackingStoreIdleListRemove(&_idle, buffer);
+		_bytesHeld -= capacity;
+		_hitCount++;
+	} else {
+		_missCount++;
+	}
+	_bytesInUse += capacity;
+	if (buffer)
+		CFDictionarySetValue(_buffersInUse, buffer->data, buffer);
+	OSSpinLockUnlock(&_lock);
+
+	if (buffer) {
+		bzero(buffer->data, capacity);
+		return buffer;
+	}
+
+	buffer = calloc(1, sizeof(TUIBackingStoreBuffer));
+	buffer->data = calloc(1, capacity);
+	buffer->capacity = capacity;
+	buffer->pool = (__bridge void *)self;
+
+	OSSpinLockLock(&_lock);
+	if (buffer->data)
+		CFDictionarySetValue(_buffersInUse, buffer->data, buffer);
+	else
+		_bytesInUse -= capacity;
+	OSSpinLockUnlock(&_lock);
+
+	if (!buffer->data) {
+		free(buffer);
+		return NULL;
+	}
+	return buffer;
+}
+
+- (void)_returnBuffer:(TUIBackingStoreBuffer *)buffer
+{
+	TUIBackingStoreBuffer *evicted = NULL;
+
+	OSSpinLockLock(&_lock);
+	_bytesInUse -= buffer->capacity;
+	CFDictionaryRemoveValue(_buffersInUse, buffer->data);
+	if (buffer->image) {
+		if (CFDictionaryGetValue(_detachedImages, buffer->image) == buffer)
+			CFDictionaryRemoveValue(_detachedImages, buffer->image);
+		buffer->image = NULL;
+		buffer->provider = NULL;
+	}
+
+	if (buffer->capacity <= _byteBudget) {
+		TUIBackingStoreIdleListAdd(&_idle, buffer);
+		_bytesHeld += buffer->capacity;
+		evicted = TUIBackingStoreIdleListEvict(&_idle, &_bytesHeld, _byteBudget);
+	} else {
+		buffer->idleNewer = NULL;
+		evicted = buffer;
+	}
+	OSSpinLockUnlock(&_lock);
+
+	TUIBackingStoreBufferFreeChain(evicted);
+}
+
+- (void)setByteBudget:(NSUInteger)budget
+{
+	OSSpinLockLock(&_lock);
+	_byteBudget = budget;
+	TUIBackingStoreBuffer *evicted = TUIBackingStoreIdleListEvict(&_idle, &_bytesHeld, budget);
+	OSSpinLockUnlock(&_lock);
+
+	TUIBackingStoreBufferFreeChain(evicted);
+}
+
+- (void)purge
+{
+	OSSpinLockLock(&_lock);
+	TUIBackingStoreBuffer *evicted = TUIBackingStoreIdleListEvict(&_idle, &_bytesHeld, 0);
+	OSSpinLockUnlock(&_lock);
+
+	TUIBackingStoreBufferFreeChain(evicted);
+}
+
+@end
@@ -77,6 +77,12 @@
  * potentially moving or clipping the receiver relative to one of its ancestor
  * views.
  *
+ * TUIView sends this at the end of the run loop turn in which an ancestor
+ * moved, resized or laid out, once for each descendant however many
+ * ancestors changed. It arrives before the turn's layer changes are
+ * committed, so anything the receiver moves in response shows up in the
+ * same frame.
+ *
  * The receiver _must_ forward this message to all of its subviews and any
  * [TUIHostView rootView].
  */
@@ -28,12 +28,19 @@ enum _TUICGRoundedRectCorner {
 typedef NSUInteger TUICGRoundedRectCorner;
 
 #import <Foundation/Foundation.h>
+#import "TUIBackingStorePool.h"
 
 @class TUIView;
 
+// Shared device RGB and gray color spaces. Do not release.
+extern CGColorSpaceRef TUIGetDeviceRGBColorSpace(void);
+extern CGColorSpaceRef TUIGetDeviceGrayColorSpace(void);
+
+// Sizes are in pixels. Contexts are backed by TUIBackingStorePool buffers.
 extern CGContextRef TUICreateOpaqueGraphicsContext(CGSize size);
 extern CGContextRef TUICreateGraphicsContext(CGSize size);
 extern CGContextRef TUICreateGraphicsContextWithOptions(CGSize size, BOOL opaque);
+extern CGContextRef TUICreateGraphicsContextWithFormat(CGSize size, BOOL opaque, TUIBackingStoreFormat format);
 extern CGImageRef TUICreateCGImageFromBitmapContext(CGContextRef ctx);
 
 extern CGPathRef TUICGPathCreateRoundedRect(CGRect rect, CGFloat radius);
@@ -62,6 +69,7 @@ extern void TUIGraphicsBeginImageContextWithOptions(CGSize size, BOOL opaque, CG
 extern NSImage *TUIGraphicsGetImageFromCurrentImageContext(void);
 extern void TUIGraphicsEndImageContext(void); 
 
+// see -[TUIView snapshotWithAlpha:]
 extern NSImage *TUIGraphicsGetImageForView(TUIView *view);
 
 extern NSImage *TUIGraphicsDrawAsImage(CGSize size, void(^draw)(void));
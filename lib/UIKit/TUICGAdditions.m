@@ -15,34 +15,39 @@
  */
 
 #import "TUICGAdditions.h"
+#import "TUIBackingStorePool.h"
+#import "TUIGraphicsCache.h"
 #import "TUIView.h"
+#import "TUIView+Snapshot.h"
+
+CGColorSpaceRef TUIGetDeviceRGBColorSpace(void)
+{
+	static CGColorSpaceRef colorSpace = NULL;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		colorSpace = CGColorSpaceCreateDeviceRGB();
+	});
+	return colorSpace;
+}
+
+CGColorSpaceRef TUIGetDeviceGrayColorSpace(void)
+{
+	static CGColorSpaceRef colorSpace = NULL;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		colorSpace = CGColorSpaceCreateDeviceGray();
+	});
+	return colorSpace;
+}
 
 CGContextRef TUICreateOpaqueGraphicsContext(CGSize size)
 {
-	size_t width = size.width;
-	size_t height = size.height;
-	size_t bitsPerComponent = 8;
-	size_t bytesPerRow = 4 * width;
-	CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
-	CGBitmapInfo bitmapInfo = kCGBitmapByteOrder32Host | kCGImageAlphaNoneSkipFirst;
-	CGContextRef ctx = CGBitmapContextCreate(NULL, width, height, bitsPerComponent, bytesPerRow, colorSpace, bitmapInfo);
-	CGColorSpaceRelease(colorSpace);
-	return ctx;
+	return [[TUIBackingStorePool sharedPool] createContextWithPixelSize:size opaque:YES];
 }
 
 CGContextRef TUICreateGraphicsContext(CGSize size)
 {
-	size_t width = size.width;
-	size_t height = size.height;
-	size_t bitsPerComponent = 8;
-	size_t bytesPerRow = 4 * width;
-	CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
-	// http://www.cocoTUIlder.com/archive/cocoa/228931-sub-pixel-font-smoothing-with-cgbitmapcontext.html
-	// http://developer.apple.com/mac/library/qa/qa2001/qa1037.html
-	CGBitmapInfo bitmapInfo = kCGBitmapByteOrder32Host | kCGImageAlphaPremultipliedFirst;
-	CGContextRef ctx = CGBitmapContextCreate(NULL, width, height, bitsPerComponent, bytesPerRow, colorSpace, bitmapInfo);
-	CGColorSpaceRelease(colorSpace);
-	return ctx;
+	return [[TUIBackingStorePool sharedPool] createContextWithPixelSize:size opaque:NO];
 }
 
 CGContextRef TUICreateGraphicsContextWithOptions(CGSize size, BOOL opaque)
@@ -53,6 +58,11 @@ CGContextRef TUICreateGraphicsContextWithOptions(CGSize size, BOOL opaque)
 		return TUICreateGraphicsContext(size);
 }
 
+CGContextRef TUICreateGraphicsContextWithFormat(CGSize size, BOOL opaque, TUIBackingStoreFormat format)
+{
+	return [[TUIBackingStorePool sharedPool] createContextWithPixelSize:size format:format opaque:opaque];
+}
+
 CGImageRef TUICreateCGImageFromBitmapContext(CGContextRef ctx) // autoreleased
 {
 	return CGBitmapContextCreateImage(ctx);
@@ -102,9 +112,19 @@ CGPathRef TUICGPathCreateRoundedRectWithCorners(CGRect rect, CGFloat radius, TUI
 
 void CGContextAddRoundRect(CGContextRef context, CGRect rect, CGFloat radius)
 {
-	CGPathRef path = TUICGPathCreateRoundedRect(rect, radius);
-	CGContextAddPath(context, path);
-	CGPathRelease(path);
+	// the cached path has its origin at zero; moving a copy of it leaves the
+	// CTM alone, which a translation there and back wouldn't exactly
+	CGPathRef path = [[TUIGraphicsCache sharedCache] roundedRectPathWithSize:rect.size radius:radius corners:TUICGRoundedRectCornerAll];
+	if (CGPointEqualToPoint(rect.origin, CGPointZero)) {
+		CGContextAddPath(context, path);
+		return;
+	}
+
+	CGAffineTransform t = CGAffineTransformMakeTranslation(rect.origin.x, rect.origin.y);
+	CGMutablePathRef moved = CGPathCreateMutable();
+	CGPathAddPath(moved, &t, path);
+	CGContextAddPath(context, moved);
+	CGPathRelease(moved);
 }
 
 void CGContextClipToRoundRect(CGContextRef context, CGRect rect, CGFloat radius)
@@ -168,12 +188,9 @@ void CGContextFillRoundRect(CGContextRef context, CGRect rect, CGFloat radius)
 
 void CGContextDrawLinearGradientBetweenPoints(CGContextRef context, CGPoint a, CGFloat color_a[4], CGPoint b, CGFloat color_b[4])
 {
-	CGColorSpaceRef colorspace = CGColorSpaceCreateDeviceRGB();
 	CGFloat components[] = { color_a[0], color_a[1], color_a[2], color_a[3], color_b[0], color_b[1], color_b[2], color_b[3] };
-	CGGradientRef gradient = CGGradientCreateWithColorComponents(colorspace, components, NULL, 2);
+	CGGradientRef gradient = [[TUIGraphicsCache sharedCache] gradientWithColorComponents:components locations:NULL count:2];
 	CGContextDrawLinearGradient(context, gradient, a, b, 0);
-	CGColorSpaceRelease(colorspace);
-	CGGradientRelease(gradient);
 }
 
 CGContextRef TUIGraphicsGetCurrentContext(void)
@@ -231,12 +248,7 @@ NSImage *TUIGraphicsGetImageFromCurrentImageContext(void)
 
 NSImage *TUIGraphicsGetImageForView(TUIView *view)
 {
-	TUIGraphicsBeginImageContext(view.frame.size);
-	[view.layer renderInContext:TUIGraphicsGetCurrentContext()];
-	NSImage *image = TUIGraphicsGetImageFromCurrentImageContext();
-	TUIGraphicsEndImageContext();
-    
-	return image;
+	return [view snapshotWithAlpha:1.0];
 }
 
 void TUIGraphicsEndImageContext(void)
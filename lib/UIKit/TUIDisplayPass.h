@@ -0,0 +1,64 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class TUIView;
+
+typedef void (^TUIDisplayPassOverrunHandler)(NSTimeInterval duration, NSUInteger deferredCount);
+
+// A TUIDisplayPass collects the views marked as needing display and
+// displays them itself, once per run loop turn, before Core Animation
+// commits, instead of leaving the order to Core Animation.
+//
+// Views on screen go first, most recently marked first, then views that
+// are in a window but out of sight. Views on screen are always displayed.
+// Once the pass has spent frameBudget, the views out of sight that are
+// left wait for the next frame. Views not in a window have their layers
+// marked as before, for Core Animation to display once they are.
+//
+// All methods must be called on the main thread.
+@interface TUIDisplayPass : NSObject
+
++ (TUIDisplayPass *)sharedDisplayPass;
+
+// Seconds a pass may spend before deferring views out of sight. 0 never
+// defers. Default is 8ms, half a 60Hz frame.
+@property (nonatomic, assign) NSTimeInterval frameBudget;
+
+// Called after each pass that took longer than frameBudget, with how long
+// it took and how many views it deferred.
+@property (nonatomic, copy) TUIDisplayPassOverrunHandler overrunHandler;
+
+// Passes that have taken longer than frameBudget so far.
+@property (nonatomic, readonly) NSUInteger overrunCount;
+
+// Views waiting for a pass.
+@property (nonatomic, readonly) NSUInteger pendingViewCount;
+
+// Queues the view for the next pass. The view is retained until then.
+- (void)setNeedsDisplayForView:(TUIView *)view;
+
+// Whether the view is queued.
+- (BOOL)needsDisplayForView:(TUIView *)view;
+
+// Displays the view now if it is queued.
+- (void)displayViewIfNeeded:(TUIView *)view;
+
+// Displays every queued view now, regardless of the budget.
+- (void)displayPendingViews;
+
+@end
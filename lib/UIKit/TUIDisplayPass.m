@@ -0,0 +1,188 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import "TUIDisplayPass.h"
+#import "TUIFrameClock.h"
+#import "TUIView.h"
+
+@interface TUIDisplayPass () {
+	// in the order they were marked, and the same views for lookups
+	NSMutableArray *_pendingViews;
+	CFMutableSetRef _pendingViewSet;
+	TUIFrameClock *_frameClock;
+}
+
+- (void)_displayPendingViewsWithinBudget:(BOOL)budgeted;
+- (void)_displayView:(TUIView *)view;
+- (void)_frameClockDidFire:(TUIFrameClock *)clock;
+
+@end
+
+static void TUIDisplayPassRunLoopObserver(CFRunLoopObserverRef observer, CFRunLoopActivity activity, void *info)
+{
+	@autoreleasepool {
+		[(__bridge TUIDisplayPass *)info _displayPendingViewsWithinBudget:YES];
+	}
+}
+
+@implementation TUIDisplayPass
+
+@synthesize frameBudget = _frameBudget;
+@synthesize overrunHandler = _overrunHandler;
+@synthesize overrunCount = _overrunCount;
+
++ (TUIDisplayPass *)sharedDisplayPass
+{
+	static TUIDisplayPass *sharedDisplayPass = nil;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		sharedDisplayPass = [[TUIDisplayPass alloc] init];
+	});
+	return sharedDisplayPass;
+}
+
+- (id)init
+{
+	if ((self = [super init])) {
+		_pendingViews = [[NSMutableArray alloc] init];
+		_pendingViewSet = CFSetCreateMutable(NULL, 0, NULL);
+		_frameBudget = 0.008;
+
+		// after frame change notifications, which may mark views, and
+		// before Core Animation commits the run loop's implicit transaction
+		CFRunLoopObserverContext context = { 0, (__bridge void *)self, NULL, NULL, NULL };
+		CFRunLoopObserverRef observer = CFRunLoopObserverCreate(NULL, kCFRunLoopBeforeWaiting | kCFRunLoopExit, true, 1999500, TUIDisplayPassRunLoopObserver, &context);
+		CFRunLoopAddObserver(CFRunLoopGetMain(), observer, kCFRunLoopCommonModes);
+		CFRelease(observer);
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	CFRelease(_pendingViewSet);
+}
+
+- (NSUInteger)pendingViewCount
+{
+	return [_pendingViews count];
+}
+
+- (void)setNeedsDisplayForView:(TUIView *)view
+{
+	if (CFSetContainsValue(_pendingViewSet, (__bridge const void *)view))
+		return;
+
+	// marked after this turn's pass, say from a transaction's layout, the
+	// run loop would otherwise sleep on it until the next event
+	if ([_pendingViews count] == 0)
+		CFRunLoopWakeUp(CFRunLoopGetMain());
+
+	CFSetAddValue(_pendingViewSet, (__bridge const void *)view);
+	[_pendingViews addObject:view];
+}
+
+- (BOOL)needsDisplayForView:(TUIView *)view
+{
+	return CFSetContainsValue(_pendingViewSet, (__bridge const void *)view);
+}
+
+- (void)displayViewIfNeeded:(TUIView *)view
+{
+	if (!CFSetContainsValue(_pendingViewSet, (__bridge const void *)view))
+		return;
+
+	TUIView *pendingView = view;
+	[_pendingViews removeObjectIdenticalTo:pendingView];
+	[self _displayView:pendingView];
+}
+
+- (void)displayPendingViews
+{
+	[self _displayPendingViewsWithinBudget:NO];
+}
+
+/**
+ * @internal
+ * @brief Display queued views, on screen ones first, deferring the rest once over budget
+ */
+- (void)_displayPendingViewsWithinBudget:(BOOL)budgeted
+{
+	if ([_pendingViews count] == 0)
+		return;
+
+	CFTimeInterval start = CACurrentMediaTime();
+	NSArray *views = [_pendingViews copy];
+	[_pendingViews removeAllObjects];
+
+	NSMutableArray *visible = [NSMutableArray array];
+	NSMutableArray *outOfSight = [NSMutableArray array];
+	for (TUIView *view in [views reverseObjectEnumerator]) {
+		if (!view.nsWindow) {
+			// Core Animation displays it if it ever makes it on screen
+			CFSetRemoveValue(_pendingViewSet, (__bridge const void *)view);
+			[view.layer setNeedsDisplay];
+		} else if ([view _isVisible]) {
+			[visible addObject:view];
+		} else {
+			[outOfSight addObject:view];
+		}
+	}
+
+	for (TUIView *view in visible)
+		[self _displayView:view];
+
+	NSMutableArray *deferred = [NSMutableArray array];
+	for (TUIView *view in outOfSight) {
+		if (budgeted && _frameBudget > 0.0 && CACurrentMediaTime() - start > _frameBudget)
+			[deferred addObject:view];
+		else
+			[self _displayView:view];
+	}
+
+	NSTimeInterval duration = CACurrentMediaTime() - start;
+	if (_frameBudget > 0.0 && duration > _frameBudget) {
+		_overrunCount++;
+		if (_overrunHandler)
+			_overrunHandler(duration, [deferred count]);
+	}
+
+	if ([deferred count] > 0) {
+		// oldest first again, behind anything marked meanwhile
+		[_pendingViews insertObjects:[[deferred reverseObjectEnumerator] allObjects] atIndexes:[NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, [deferred count])]];
+
+		// wakes the run loop at the next frame, whose pass takes them up
+		if (!_frameClock) {
+			_frameClock = [TUIFrameClock mainFrameClock];
+			[_frameClock addTarget:self action:@selector(_frameClockDidFire:)];
+		}
+	}
+}
+
+- (void)_displayView:(TUIView *)view
+{
+	CFSetRemoveValue(_pendingViewSet, (__bridge const void *)view);
+	[view.layer setNeedsDisplay];
+	[view.layer displayIfNeeded];
+}
+
+- (void)_frameClockDidFire:(TUIFrameClock *)clock
+{
+	[_frameClock removeTarget:self];
+	_frameClock = nil;
+}
+
+@end
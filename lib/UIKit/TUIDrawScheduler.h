@@ -0,0 +1,65 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+typedef id (^TUIDrawSchedulerDrawBlock)(void);
+typedef void (^TUIDrawSchedulerCommitBlock)(id result);
+typedef CGFloat (^TUIDrawSchedulerPriorityBlock)(void);
+typedef void (^TUIDrawSchedulerDiscardBlock)(void);
+
+// A TUIDrawScheduler runs background drawing for views that draw in the
+// background (see TUIView's drawInBackground).
+//
+// There is at most one draw per owner. Scheduling again before the previous
+// draw has started replaces it. Scheduling again after it has started lets
+// it finish but throws its result away. Queued draws start highest
+// priority first, asking each job's priority block (on the main thread)
+// when a slot frees up, so a view that scrolled away since it was
+// scheduled sinks behind ones that are still visible. No more draws run at
+// once than there are cores.
+//
+// Results are not applied as each draw finishes. They are collected and
+// committed together once per frame, from the main display's
+// TUIFrameClock, inside a single transaction. Until then the owner keeps
+// showing whatever it showed before.
+//
+// All methods must be called on the main thread.
+@interface TUIDrawScheduler : NSObject
+
++ (TUIDrawScheduler *)sharedScheduler;
+
+// Default is the number of active processor cores.
+@property (nonatomic, assign) NSUInteger maximumConcurrentDraws;
+
+// Draws and results waiting to be committed.
+@property (nonatomic, readonly) NSUInteger pendingDrawCount;
+
+// Schedules draw to run on a background queue and commit to run on the
+// main thread, with draw's return value, at the next frame after it
+// finishes. The owner is not retained by the scheduler. priority may be
+// nil; higher values start first.
+//
+// discard, which may be nil, runs on the main thread instead of draw when
+// the draw is replaced or cancelled before it starts, to release whatever
+// was set aside for it.
+- (void)scheduleDrawForOwner:(id)owner priority:(TUIDrawSchedulerPriorityBlock)priority draw:(TUIDrawSchedulerDrawBlock)draw commit:(TUIDrawSchedulerCommitBlock)commit discard:(TUIDrawSchedulerDiscardBlock)discard;
+
+// Drops the owner's queued draw (running its discard block), or the result
+// of its running or finished draw, without committing it.
+- (void)cancelDrawForOwner:(id)owner;
+
+@end
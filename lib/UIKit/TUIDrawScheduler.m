@@ -0,0 +1,221 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import "TUIDrawScheduler.h"
+#import "TUIFrameClock.h"
+
+@interface TUIDrawSchedulerJob : NSObject
+
+@property (nonatomic, copy) TUIDrawSchedulerPriorityBlock priority;
+@property (nonatomic, copy) TUIDrawSchedulerDrawBlock draw;
+@property (nonatomic, copy) TUIDrawSchedulerCommitBlock commit;
+@property (nonatomic, copy) TUIDrawSchedulerDiscardBlock discard;
+@property (nonatomic, strong) id result;
+@property (nonatomic, assign) NSUInteger sequence;
+
+@end
+
+@implementation TUIDrawSchedulerJob
+
+@synthesize priority;
+@synthesize draw;
+@synthesize commit;
+@synthesize discard;
+@synthesize result;
+@synthesize sequence;
+
+@end
+
+@interface TUIDrawScheduler () {
+	// owner -> its current job; anything not in here has been superseded
+	NSMapTable *_currentJobs;
+	NSMutableArray *_queuedJobs;
+	NSMutableArray *_finishedJobs;
+	NSUInteger _runningCount;
+	NSUInteger _nextSequence;
+	TUIFrameClock *_frameClock;
+}
+
+- (void)_startQueuedDraws;
+- (void)_commitFinishedDraws:(TUIFrameClock *)clock;
+
+@end
+
+@implementation TUIDrawScheduler
+
+@synthesize maximumConcurrentDraws = _maximumConcurrentDraws;
+
++ (TUIDrawScheduler *)sharedScheduler
+{
+	static TUIDrawScheduler *sharedScheduler = nil;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		sharedScheduler = [[TUIDrawScheduler alloc] init];
+	});
+	return sharedScheduler;
+}
+
+- (id)init
+{
+	if ((self = [super init])) {
+		_currentJobs = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsObjectPointerPersonality
+											 valueOptions:NSPointerFunctionsStrongMemory];
+		_queuedJobs = [[NSMutableArray alloc] init];
+		_finishedJobs = [[NSMutableArray alloc] init];
+		_maximumConcurrentDraws = MAX(1, [[NSProcessInfo processInfo] activeProcessorCount]);
+	}
+	return self;
+}
+
+- (void)setMaximumConcurrentDraws:(NSUInteger)count
+{
+	_maximumConcurrentDraws = MAX(1, count);
+	[self _startQueuedDraws];
+}
+
+- (NSUInteger)pendingDrawCount
+{
+	return [_currentJobs count];
+}
+
+- (void)scheduleDrawForOwner:(id)owner priority:(TUIDrawSchedulerPriorityBlock)priority draw:(TUIDrawSchedulerDrawBlock)draw commit:(TUIDrawSchedulerCommitBlock)commit discard:(TUIDrawSchedulerDiscardBlock)discard
+{
+	NSParameterAssert(owner != nil);
+	NSParameterAssert(draw != nil);
+
+	TUIDrawSchedulerJob *job = [_currentJobs objectForKey:owner];
+
+	// not started yet, just swap in the new work
+	if (job && [_queuedJobs indexOfObjectIdenticalTo:job] != NSNotFound) {
+		if (job.discard)
+			job.discard();
+		job.priority = priority;
+		job.draw = draw;
+		job.commit = commit;
+		job.discard = discard;
+		return;
+	}
+
+	// running or finished, let it be superseded
+	[_finishedJobs removeObjectIdenticalTo:job];
+
+	job = [[TUIDrawSchedulerJob alloc] init];
+	job.priority = priority;
+	job.draw = draw;
+	job.commit = commit;
+	job.discard = discard;
+	job.sequence = _nextSequence++;
+
+	[_currentJobs setObject:job forKey:owner];
+	[_queuedJobs addObject:job];
+	[self _startQueuedDraws];
+}
+
+- (void)cancelDrawForOwner:(id)owner
+{
+	TUIDrawSchedulerJob *job = [_currentJobs objectForKey:owner];
+	if (!job)
+		return;
+
+	if ([_queuedJobs indexOfObjectIdenticalTo:job] != NSNotFound) {
+		[_queuedJobs removeObjectIdenticalTo:job];
+		if (job.discard)
+			job.discard();
+	}
+	[_finishedJobs removeObjectIdenticalTo:job];
+	[_currentJobs removeObjectForKey:owner];
+}
+
+/**
+ * @internal
+ * @brief Start queued draws, best first, until every slot is busy
+ */
+- (void)_startQueuedDraws
+{
+	while (_runningCount < _maximumConcurrentDraws && [_queuedJobs count] > 0) {
+		TUIDrawSchedulerJob *best = nil;
+		CGFloat bestPriority = 0.0;
+
+		for (TUIDrawSchedulerJob *job in _queuedJobs) {
+			CGFloat p = (job.priority != nil) ? job.priority() : 0.0;
+			if (!best || p > bestPriority || (p == bestPriority && job.sequence < best.sequence)) {
+				best = job;
+				bestPriority = p;
+			}
+		}
+
+		[_queuedJobs removeObjectIdenticalTo:best];
+		_runningCount++;
+
+		TUIDrawSchedulerDrawBlock draw = best.draw;
+		best.discard = nil;
+		dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+			id result = draw();
+
+			dispatch_async(dispatch_get_main_queue(), ^{
+				_runningCount--;
+
+				// superseded or cancelled jobs are no longer anyone's current job
+				BOOL current = NO;
+				for (TUIDrawSchedulerJob *job in [_currentJobs objectEnumerator]) {
+					if (job == best) {
+						current = YES;
+						break;
+					}
+				}
+
+				if (current) {
+					best.result = result;
+					[_finishedJobs addObject:best];
+
+					if (!_frameClock) {
+						_frameClock = [TUIFrameClock mainFrameClock];
+						[_frameClock addTarget:self action:@selector(_commitFinishedDraws:)];
+					}
+				}
+
+				[self _startQueuedDraws];
+			});
+		});
+	}
+}
+
+/**
+ * @internal
+ * @brief Apply every result that finished since the last frame in one go
+ */
+- (void)_commitFinishedDraws:(TUIFrameClock *)clock
+{
+	NSArray *finished = [_finishedJobs copy];
+	[_finishedJobs removeAllObjects];
+
+	for (id owner in [[_currentJobs keyEnumerator] allObjects]) {
+		if ([finished indexOfObjectIdenticalTo:[_currentJobs objectForKey:owner]] != NSNotFound)
+			[_currentJobs removeObjectForKey:owner];
+	}
+
+	[CATransaction begin];
+	for (TUIDrawSchedulerJob *job in finished) {
+		if (job.commit)
+			job.commit(job.result);
+	}
+	[CATransaction commit];
+
+	[_frameClock removeTarget:self];
+	_frameClock = nil;
+}
+
+@end
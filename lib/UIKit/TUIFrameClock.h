@@ -0,0 +1,73 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+#import <QuartzCore/QuartzCore.h>
+
+@class NSWindow;
+
+// A TUIFrameClock wraps a single CVDisplayLink for a display and fans
+// its refresh callbacks out to any number of targets on the main thread.
+// Every animating object on a display shares the same clock, so a window
+// full of scrolling views costs one display link and one main thread hop
+// per refresh instead of one per view.
+//
+// The display link only runs while the clock has targets. If the main
+// thread falls behind, refreshes are coalesced: targets are called at most
+// once per delivered frame and always see the most recent timestamp.
+@interface TUIFrameClock : NSObject
+
+// The shared clock for the main display.
++ (TUIFrameClock *)mainFrameClock;
+
+// The shared clock for the given display, created on first use.
++ (TUIFrameClock *)frameClockForDisplayID:(CGDirectDisplayID)displayID;
+
+// The shared clock for the display the window is on, or the main
+// display's clock if the window is nil or offscreen.
++ (TUIFrameClock *)frameClockForWindow:(NSWindow *)window;
+
+// The display this clock is synchronized to.
+@property (nonatomic, readonly) CGDirectDisplayID displayID;
+
+// Returns YES while the underlying display link is running.
+@property (nonatomic, readonly, getter = isRunning) BOOL running;
+
+// The time, in the CACurrentMediaTime() timebase, at which the frame
+// currently being delivered will be shown on screen. Only meaningful
+// from within a target's action.
+@property (nonatomic, readonly) CFTimeInterval targetTimestamp;
+
+// The display's refresh period, in seconds.
+@property (nonatomic, readonly) CFTimeInterval frameInterval;
+
+// Registers the target to receive the action once per frame. The action
+// takes one argument, the clock. Targets are not retained and must be
+// removed before they are deallocated. Adding a target that is already
+// registered replaces its action.
+- (void)addTarget:(id)target action:(SEL)action;
+
+// Registers the target with the clock of the display the window is on,
+// and returns that clock. Whenever the window moves to another screen, the
+// target is moved to that display's clock. -removeTarget: on the returned
+// clock removes it from whichever clock it is on by then.
++ (TUIFrameClock *)addTarget:(id)target action:(SEL)action forWindow:(NSWindow *)window;
+
+// Stops delivering frames to the target. When the last target is
+// removed the display link is stopped.
+- (void)removeTarget:(id)target;
+
+@end
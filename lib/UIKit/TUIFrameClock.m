@@ -0,0 +1,257 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import "TUIFrameClock.h"
+#import <AppKit/AppKit.h>
+#import <libkern/OSAtomic.h>
+
+// a target added for a window, and the clock it is on now
+@interface TUIFrameClockWindowTarget : NSObject
+
+@property (nonatomic, unsafe_unretained) NSWindow *window;
+@property (nonatomic, copy) NSString *actionName;
+@property (nonatomic, unsafe_unretained) TUIFrameClock *clock;
+
+@end
+
+@implementation TUIFrameClockWindowTarget
+
+@synthesize window;
+@synthesize actionName;
+@synthesize clock;
+
+@end
+
+@interface TUIFrameClock () {
+	CVDisplayLinkRef _displayLink;
+	NSMapTable *_targets;
+
+	volatile int32_t _framePending;
+	volatile CFTimeInterval _pendingTimestamp;
+}
+
+- (id)initWithDisplayID:(CGDirectDisplayID)displayID;
+- (void)_deliverFrame;
+- (void)_detachTarget:(id)target;
++ (void)_windowDidChangeScreen:(NSNotification *)notification;
+
+@end
+
+@implementation TUIFrameClock
+
+@synthesize displayID = _displayID;
+@synthesize targetTimestamp = _targetTimestamp;
+
+// Clocks are created on the main thread and live for the life of the
+// process, so the display link callback can hold an unretained pointer.
+static NSMutableDictionary *TUIFrameClocks = nil;
+
+// target -> TUIFrameClockWindowTarget, for targets added for a window
+static NSMapTable *TUIFrameClockWindowTargets = nil;
+
++ (TUIFrameClock *)frameClockForDisplayID:(CGDirectDisplayID)displayID
+{
+	if (!TUIFrameClocks)
+		TUIFrameClocks = [[NSMutableDictionary alloc] init];
+
+	NSNumber *key = [NSNumber numberWithUnsignedInt:displayID];
+	TUIFrameClock *clock = [TUIFrameClocks objectForKey:key];
+	if (!clock) {
+		clock = [[self alloc] initWithDisplayID:displayID];
+		[TUIFrameClocks setObject:clock forKey:key];
+	}
+	return clock;
+}
+
++ (TUIFrameClock *)mainFrameClock
+{
+	return [self frameClockForDisplayID:CGMainDisplayID()];
+}
+
++ (TUIFrameClock *)frameClockForWindow:(NSWindow *)window
+{
+	NSNumber *screenNumber = [[[window screen] deviceDescription] objectForKey:@"NSScreenNumber"];
+	if (!screenNumber)
+		return [self mainFrameClock];
+	return [self frameClockForDisplayID:[screenNumber unsignedIntValue]];
+}
+
++ (TUIFrameClock *)addTarget:(id)target action:(SEL)action forWindow:(NSWindow *)window
+{
+	TUIFrameClock *clock = [self frameClockForWindow:window];
+
+	TUIFrameClockWindowTarget *record = [TUIFrameClockWindowTargets objectForKey:target];
+	if (record && record.clock != clock)
+		[record.clock removeTarget:target];
+
+	[clock addTarget:target action:action];
+	if (!window)
+		return clock;
+
+	if (!TUIFrameClockWindowTargets) {
+		TUIFrameClockWindowTargets = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsObjectPointerPersonality
+														   valueOptions:NSPointerFunctionsStrongMemory];
+		[[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(_windowDidChangeScreen:) name:NSWindowDidChangeScreenNotification object:nil];
+	}
+
+	record = [[TUIFrameClockWindowTarget alloc] init];
+	record.window = window;
+	record.actionName = NSStringFromSelector(action);
+	record.clock = clock;
+	[TUIFrameClockWindowTargets setObject:record forKey:target];
+	return clock;
+}
+
+/**
+ * @internal
+ * @brief Move the window's targets to the clock of the display it is on now
+ */
++ (void)_windowDidChangeScreen:(NSNotification *)notification
+{
+	NSWindow *window = [notification object];
+	TUIFrameClock *clock = [self frameClockForWindow:window];
+
+	for (id target in [[TUIFrameClockWindowTargets keyEnumerator] allObjects]) {
+		TUIFrameClockWindowTarget *record = [TUIFrameClockWindowTargets objectForKey:target];
+		if (record.window != window || record.clock == clock)
+			continue;
+
+		[record.clock _detachTarget:target];
+		record.clock = clock;
+		[clock addTarget:target action:NSSelectorFromString(record.actionName)];
+	}
+}
+
+static CVReturn TUIFrameClockCallback(CVDisplayLinkRef displayLink, const CVTimeStamp *now, const CVTimeStamp *outputTime, CVOptionFlags flagsIn, CVOptionFlags *flagsOut, void *displayLinkContext)
+{
+	TUIFrameClock *clock = (__bridge TUIFrameClock *)displayLinkContext;
+	clock->_pendingTimestamp = (CFTimeInterval)outputTime->hostTime / CVGetHostClockFrequency();
+
+	// if the main thread hasn't picked up the last frame yet, it'll see
+	// the timestamp above when it does
+	if (OSAtomicCompareAndSwap32Barrier(0, 1, &clock->_framePending)) {
+		dispatch_async(dispatch_get_main_queue(), ^{
+			[clock _deliverFrame];
+		});
+	}
+	return kCVReturnSuccess;
+}
+
+- (id)initWithDisplayID:(CGDirectDisplayID)displayID
+{
+	if ((self = [super init])) {
+		_displayID = displayID;
+		_targets = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsObjectPointerPersonality
+										 valueOptions:NSPointerFunctionsStrongMemory];
+
+		if (CVDisplayLinkCreateWithCGDisplay(displayID, &_displayLink) != kCVReturnSuccess)
+			CVDisplayLinkCreateWithActiveCGDisplays(&_displayLink);
+		CVDisplayLinkSetOutputCallback(_displayLink, &TUIFrameClockCallback, (__bridge void *)self);
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	if (_displayLink) {
+		CVDisplayLinkStop(_displayLink);
+		CVDisplayLinkRelease(_displayLink);
+	}
+}
+
+- (BOOL)isRunning
+{
+	return _displayLink && CVDisplayLinkIsRunning(_displayLink);
+}
+
+- (CFTimeInterval)frameInterval
+{
+	if (!_displayLink)
+		return 1.0 / 60.0;
+
+	CFTimeInterval interval = CVDisplayLinkGetActualOutputVideoRefreshPeriod(_displayLink);
+	if (interval > 0.0)
+		return interval;
+
+	CVTime nominal = CVDisplayLinkGetNominalOutputVideoRefreshPeriod(_displayLink);
+	if (!(nominal.flags & kCVTimeIsIndefinite) && nominal.timeScale > 0 && nominal.timeValue > 0)
+		return (CFTimeInterval)nominal.timeValue / nominal.timeScale;
+
+	return 1.0 / 60.0;
+}
+
+- (void)addTarget:(id)target action:(SEL)action
+{
+	NSParameterAssert(target != nil);
+	NSParameterAssert(action != NULL);
+
+	[_targets setObject:NSStringFromSelector(action) forKey:target];
+
+	if (_displayLink && !CVDisplayLinkIsRunning(_displayLink)) {
+		_targetTimestamp = CACurrentMediaTime();
+		CVDisplayLinkStart(_displayLink);
+	}
+}
+
+- (void)removeTarget:(id)target
+{
+	if (!target)
+		return;
+
+	// it may have followed its window to another display's clock
+	TUIFrameClockWindowTarget *record = [TUIFrameClockWindowTargets objectForKey:target];
+	if (record) {
+		TUIFrameClock *clock = record.clock;
+		[TUIFrameClockWindowTargets removeObjectForKey:target];
+		if (clock != self)
+			[clock _detachTarget:target];
+	}
+
+	[self _detachTarget:target];
+}
+
+/**
+ * @internal
+ * @brief Stop delivering frames to the target from this clock alone
+ */
+- (void)_detachTarget:(id)target
+{
+	[_targets removeObjectForKey:target];
+
+	if ([_targets count] == 0 && _displayLink)
+		CVDisplayLinkStop(_displayLink);
+}
+
+- (void)_deliverFrame
+{
+	OSAtomicCompareAndSwap32Barrier(1, 0, &_framePending);
+	_targetTimestamp = _pendingTimestamp;
+
+	// targets may add or remove themselves (or each other) from their action
+	for (id target in [[_targets keyEnumerator] allObjects]) {
+		NSString *actionName = [_targets objectForKey:target];
+		if (!actionName)
+			continue;
+
+		SEL action = NSSelectorFromString(actionName);
+		((void (*)(id, SEL, id))[target methodForSelector:action])(target, action, self);
+	}
+
+	if ([_targets count] == 0 && _displayLink)
+		CVDisplayLinkStop(_displayLink);
+}
+
+@end
@@ -0,0 +1,63 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import <Cocoa/Cocoa.h>
+#import "TUICGAdditions.h"
+
+// A TUIGraphicsCache interns immutable drawing resources, so drawing code
+// that asks for the same color, gradient or path over and over gets the
+// same object back instead of building a new one each time.
+//
+// Colors, gradients and paths are looked up by value: their components,
+// stops, or size, radius and corners. Pattern colors are looked up by
+// their image. The cache holds at most countLimit objects and lets the
+// least recently used ones go past that, or under memory pressure.
+//
+// It may be used from any thread. Objects it returns follow the Get rule,
+// and stay valid until the current autorelease pool is drained even if
+// they are evicted meanwhile.
+@interface TUIGraphicsCache : NSObject
+
+// The cache used by TwUI's own drawing helpers.
++ (TUIGraphicsCache *)sharedCache;
+
+// Default is 512.
+@property (nonatomic, assign) NSUInteger countLimit;
+
+- (void)removeAllObjects;
+
+// A color with as many components (alpha included) as the color space
+// takes.
+- (CGColorRef)colorWithColorSpace:(CGColorSpaceRef)colorSpace components:(const CGFloat *)components;
+
+// The CGColor remembered for an NSColor, or NULL. Colors from catalogs,
+// which may change with the system appearance, are never remembered.
+- (CGColorRef)CGColorForColor:(NSColor *)color;
+- (void)setCGColor:(CGColorRef)CGColor forColor:(NSColor *)color;
+
+// The pattern color remembered for a pattern image, or NULL.
+- (CGColorRef)CGColorForPatternImage:(NSImage *)image;
+- (void)setCGColor:(CGColorRef)CGColor forPatternImage:(NSImage *)image;
+
+// An axial gradient in the device RGB color space, from count RGBA colors.
+// locations may be NULL to space them evenly.
+- (CGGradientRef)gradientWithColorComponents:(const CGFloat *)components locations:(const CGFloat *)locations count:(size_t)count;
+
+// A rounded rect of the given size with its origin at zero, see
+// TUICGPathCreateRoundedRectWithCorners.
+- (CGPathRef)roundedRectPathWithSize:(CGSize)size radius:(CGFloat)radius corners:(TUICGRoundedRectCorner)corners;
+
+@end
@@ -0,0 +1,176 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import "TUIGraphicsCache.h"
+
+enum {
+	TUIGraphicsCacheKindColor,
+	TUIGraphicsCacheKindGradient,
+	TUIGraphicsCacheKindRoundedRect,
+};
+
+@interface TUIGraphicsCache () {
+	NSCache *_cache;
+}
+
+- (NSMutableData *)_keyOfKind:(uint8_t)kind;
+- (CFTypeRef)_objectForKey:(id)key;
+
+@end
+
+@implementation TUIGraphicsCache
+
++ (TUIGraphicsCache *)sharedCache
+{
+	static TUIGraphicsCache *sharedCache = nil;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		sharedCache = [[TUIGraphicsCache alloc] init];
+	});
+	return sharedCache;
+}
+
+- (id)init
+{
+	if ((self = [super init])) {
+		_cache = [[NSCache alloc] init];
+		_cache.countLimit = 512;
+	}
+	return self;
+}
+
+- (NSUInteger)countLimit
+{
+	return _cache.countLimit;
+}
+
+- (void)setCountLimit:(NSUInteger)countLimit
+{
+	_cache.countLimit = countLimit;
+}
+
+- (void)removeAllObjects
+{
+	[_cache removeAllObjects];
+}
+
+- (NSMutableData *)_keyOfKind:(uint8_t)kind
+{
+	return [NSMutableData dataWithBytes:&kind length:sizeof(kind)];
+}
+
+/**
+ * @internal
+ * @brief Look up a cached object, keeping it alive for the caller's autorelease pool
+ */
+- (CFTypeRef)_objectForKey:(id)key
+{
+	__autoreleasing id object = [_cache objectForKey:key];
+	return (__bridge CFTypeRef)object;
+}
+
+- (CGColorRef)colorWithColorSpace:(CGColorSpaceRef)colorSpace components:(const CGFloat *)components
+{
+	size_t count = CGColorSpaceGetNumberOfComponents(colorSpace) + 1;
+	NSMutableData *key = [self _keyOfKind:TUIGraphicsCacheKindColor];
+	[key appendBytes:&colorSpace length:sizeof(colorSpace)];
+	[key appendBytes:components length:count * sizeof(CGFloat)];
+
+	CGColorRef color = (CGColorRef)[self _objectForKey:key];
+	if (color)
+		return color;
+
+	color = CGColorCreate(colorSpace, components);
+	if (!color)
+		return NULL;
+
+	// the key names the color space by address; the color retains it, so
+	// the address can't be reused while the entry exists
+	__autoreleasing id object = CFBridgingRelease(color);
+	[_cache setObject:object forKey:key];
+	return (__bridge CGColorRef)object;
+}
+
+- (CGColorRef)CGColorForColor:(NSColor *)color
+{
+	if (!color || [[color colorSpaceName] isEqualToString:NSNamedColorSpace])
+		return NULL;
+	return (CGColorRef)[self _objectForKey:color];
+}
+
+- (void)setCGColor:(CGColorRef)CGColor forColor:(NSColor *)color
+{
+	if (!CGColor || !color || [[color colorSpaceName] isEqualToString:NSNamedColorSpace])
+		return;
+	[_cache setObject:(__bridge id)CGColor forKey:color];
+}
+
+- (CGColorRef)CGColorForPatternImage:(NSImage *)image
+{
+	if (!image)
+		return NULL;
+	return (CGColorRef)[self _objectForKey:image];
+}
+
+- (void)setCGColor:(CGColorRef)CGColor forPatternImage:(NSImage *)image
+{
+	// images compare by identity; the cache keeps the image alive, so its
+	// address can't be reused while the entry exists
+	if (!CGColor || !image)
+		return;
+	[_cache setObject:(__bridge id)CGColor forKey:image];
+}
+
+- (CGGradientRef)gradientWithColorComponents:(const CGFloat *)components locations:(const CGFloat *)locations count:(size_t)count
+{
+	uint8_t hasLocations = (locations != NULL);
+	NSMutableData *key = [self _keyOfKind:TUIGraphicsCacheKindGradient];
+	[key appendBytes:&hasLocations length:sizeof(hasLocations)];
+	[key appendBytes:components length:count * 4 * sizeof(CGFloat)];
+	if (locations)
+		[key appendBytes:locations length:count * sizeof(CGFloat)];
+
+	CGGradientRef gradient = (CGGradientRef)[self _objectForKey:key];
+	if (gradient)
+		return gradient;
+
+	gradient = CGGradientCreateWithColorComponents(TUIGetDeviceRGBColorSpace(), components, locations, count);
+	if (!gradient)
+		return NULL;
+
+	__autoreleasing id object = CFBridgingRelease(gradient);
+	[_cache setObject:object forKey:key];
+	return (__bridge CGGradientRef)object;
+}
+
+- (CGPathRef)roundedRectPathWithSize:(CGSize)size radius:(CGFloat)radius corners:(TUICGRoundedRectCorner)corners
+{
+	NSMutableData *key = [self _keyOfKind:TUIGraphicsCacheKindRoundedRect];
+	[key appendBytes:&size length:sizeof(size)];
+	[key appendBytes:&radius length:sizeof(radius)];
+	[key appendBytes:&corners length:sizeof(corners)];
+
+	CGPathRef path = (CGPathRef)[self _objectForKey:key];
+	if (path)
+		return path;
+
+	path = TUICGPathCreateRoundedRectWithCorners(CGRectMake(0, 0, size.width, size.height), radius, corners);
+	__autoreleasing id object = CFBridgingRelease(path);
+	[_cache setObject:object forKey:key];
+	return (__bridge CGPathRef)object;
+}
+
+@end
@@ -0,0 +1,39 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class TUIView;
+
+// Remembers the path of the last hit test, from the root view down to the
+// view that was hit, along with the rects (in root view coordinates) of
+// every view on it and of every view in front of it. While the pointer
+// stays inside the path and outside everything in front of it, the same
+// view is hit again without walking the hierarchy.
+//
+// The cache is dropped whenever views are added, removed, moved, resized,
+// hidden or made non-interactive (see TUIViewGetHitTestGeneration()), or
+// when the layers on the path were moved directly, as by scrolling. Paths
+// through views that override -hitTest:withEvent: or -pointInside:withEvent:
+// or aren't axis-aligned are never cached.
+@interface TUIHitTestCache : NSObject
+
+// Equivalent to [rootView hitTest:point withEvent:nil].
+- (TUIView *)viewAtPoint:(CGPoint)point inRootView:(TUIView *)rootView;
+
+- (void)invalidate;
+
+@end
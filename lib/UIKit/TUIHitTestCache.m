@@ -0,0 +1,189 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import "TUIHitTestCache.h"
+#import "TUIView.h"
+#import "TUIView+Private.h"
+
+// past this many views in front of the path, a full hit test is cheaper
+#define TUIHitTestCacheMaximumOccluders 64
+
+@interface TUIHitTestCache () {
+	__unsafe_unretained TUIView *_rootView;
+	NSUInteger _generation;
+
+	// root view first, hit view last
+	NSArray *_path;
+	// per view on the path: its rect in the root view, and its layer's
+	// bounds and position when the path was cached
+	NSMutableData *_pathRects;
+	NSMutableData *_pathBounds;
+	NSMutableData *_pathPositions;
+	// rects of views in front of the path, which would take the hit instead
+	NSMutableData *_occluderRects;
+}
+
+- (BOOL)_pathContainsPoint:(CGPoint)point;
+- (void)_cachePathToView:(TUIView *)view inRootView:(TUIView *)rootView;
+
+@end
+
+@implementation TUIHitTestCache
+
+- (id)init
+{
+	if ((self = [super init])) {
+		_pathRects = [[NSMutableData alloc] init];
+		_pathBounds = [[NSMutableData alloc] init];
+		_pathPositions = [[NSMutableData alloc] init];
+		_occluderRects = [[NSMutableData alloc] init];
+	}
+	return self;
+}
+
+- (TUIView *)viewAtPoint:(CGPoint)point inRootView:(TUIView *)rootView
+{
+	if (_path && rootView == _rootView && _generation == TUIViewGetHitTestGeneration() && [self _pathContainsPoint:point])
+		return [_path lastObject];
+
+	TUIView *view = [rootView hitTest:point withEvent:nil];
+	[self _cachePathToView:view inRootView:rootView];
+	return view;
+}
+
+- (void)invalidate
+{
+	_path = nil;
+	_rootView = nil;
+}
+
+static BOOL TUIViewHitTestsItsBounds(TUIView *view)
+{
+	static IMP hitTestIMP = NULL;
+	static IMP pointInsideIMP = NULL;
+	if (!hitTestIMP) {
+		hitTestIMP = [TUIView instanceMethodForSelector:@selector(hitTest:withEvent:)];
+		pointInsideIMP = [TUIView instanceMethodForSelector:@selector(pointInside:withEvent:)];
+	}
+	return [view methodForSelector:@selector(hitTest:withEvent:)] == hitTestIMP &&
+		   [view methodForSelector:@selector(pointInside:withEvent:)] == pointInsideIMP;
+}
+
+static BOOL TUIViewTakesHits(TUIView *view)
+{
+	return view.userInteractionEnabled && !view.hidden && view.alpha > 0.0f;
+}
+
+/**
+ * @internal
+ * @brief Whether a hit test at the point would still end at the cached view
+ */
+- (BOOL)_pathContainsPoint:(CGPoint)point
+{
+	const CGRect *rects = [_pathRects bytes];
+	const CGRect *bounds = [_pathBounds bytes];
+	const CGPoint *positions = [_pathPositions bytes];
+
+	NSUInteger i = 0;
+	for (TUIView *view in _path) {
+		CALayer *layer = view.layer;
+		if (!CGRectContainsPoint(rects[i], point))
+			return NO;
+		if (!CGRectEqualToRect(layer.bounds, bounds[i]) || !CGPointEqualToPoint(layer.position, positions[i]))
+			return NO;
+		if (!TUIViewTakesHits(view))
+			return NO;
+		i++;
+	}
+
+	const CGRect *occluders = [_occluderRects bytes];
+	NSUInteger occluderCount = [_occluderRects length] / sizeof(CGRect);
+	for (i = 0; i < occluderCount; i++) {
+		if (CGRectContainsPoint(occluders[i], point))
+			return NO;
+	}
+
+	return YES;
+}
+
+/**
+ * @internal
+ * @brief Remember the path down to a freshly hit view, if it can be checked by rects alone
+ */
+- (void)_cachePathToView:(TUIView *)view inRootView:(TUIView *)rootView
+{
+	_path = nil;
+	if (!view)
+		return;
+
+	NSMutableArray *path = [NSMutableArray array];
+	for (TUIView *v = view; v != nil; v = v.superview) {
+		[path insertObject:v atIndex:0];
+		if (v == rootView)
+			break;
+	}
+	if ([path objectAtIndex:0] != rootView)
+		return;
+
+	[_pathRects setLength:0];
+	[_pathBounds setLength:0];
+	[_pathPositions setLength:0];
+	[_occluderRects setLength:0];
+
+	for (TUIView *v in path) {
+		CGAffineTransform t = v.transform;
+		if (!TUIViewHitTestsItsBounds(v) || t.b != 0.0 || t.c != 0.0 || !CATransform3DIsAffine(v.layer.transform))
+			return;
+
+		CALayer *layer = v.layer;
+		CGRect rect = [v convertRect:v.bounds toView:rootView];
+		CGRect bounds = layer.bounds;
+		CGPoint position = layer.position;
+		[_pathRects appendBytes:&rect length:sizeof(rect)];
+		[_pathBounds appendBytes:&bounds length:sizeof(bounds)];
+		[_pathPositions appendBytes:&position length:sizeof(position)];
+	}
+
+	// everything in front of the next view down, at every level, plus the
+	// hit view's own subviews, which missed this time but may not next time
+	NSUInteger count = [path count];
+	for (NSUInteger i = 0; i < count; i++) {
+		TUIView *ancestor = [path objectAtIndex:i];
+		NSArray *sorted = [ancestor sortedSubviews];
+		NSUInteger first = 0;
+		if (i + 1 < count)
+			first = [sorted indexOfObjectIdenticalTo:[path objectAtIndex:i + 1]] + 1;
+
+		for (NSUInteger j = first; j < [sorted count]; j++) {
+			TUIView *occluder = [sorted objectAtIndex:j];
+			if (!TUIViewTakesHits(occluder))
+				continue;
+			if (!TUIViewHitTestsItsBounds(occluder))
+				return;
+			if ([_occluderRects length] / sizeof(CGRect) >= TUIHitTestCacheMaximumOccluders)
+				return;
+
+			CGRect rect = [occluder convertRect:occluder.bounds toView:rootView];
+			[_occluderRects appendBytes:&rect length:sizeof(rect)];
+		}
+	}
+
+	_path = path;
+	_rootView = rootView;
+	_generation = TUIViewGetHitTestGeneration();
+}
+
+@end
@@ -22,6 +22,7 @@
 - (void)setImage:(NSImage *)i
 {
 	_image = i;
+	[self _updateInferredOpacity];
 	[self setNeedsDisplay];
 }
 
@@ -35,6 +36,7 @@
 
 	self.userInteractionEnabled = NO;
 	_image = image;
+	[self _updateInferredOpacity];
 
 	return self;
 }
@@ -48,6 +50,27 @@
     [_image drawInRect:rect fromRect:NSZeroRect operation:NSCompositeSourceOver fraction:1.0];
 }
 
+// -drawRect: above stretches the image over every rect it is asked to
+// draw, so an image with only opaque representations covers the view, as
+// long as it is that -drawRect: doing the drawing
+- (BOOL)_drawsOpaqueContent
+{
+	if(self.drawRect != nil)
+		return NO;
+	if([self methodForSelector:@selector(drawRect:)] != [TUIImageView instanceMethodForSelector:@selector(drawRect:)])
+		return NO;
+
+	NSArray *representations = [_image representations];
+	if([representations count] == 0)
+		return NO;
+
+	for(NSImageRep *representation in representations) {
+		if(![representation isOpaque])
+			return NO;
+	}
+	return YES;
+}
+
 - (CGSize)sizeThatFits:(CGSize)size {
 	return _image.size;
 }
@@ -25,10 +25,15 @@
 #import "NSView+TUIExtensions.h"
 #import "TUIActivityIndicatorView.h"
 #import "TUIAttributedString.h"
+#import "TUIBackingStorePool.h"
 #import "TUIBridgedScrollView.h"
 #import "TUIBridgedView.h"
 #import "TUIButton.h"
 #import "TUICGAdditions.h"
+#import "TUIDisplayPass.h"
+#import "TUIDrawScheduler.h"
+#import "TUIFrameClock.h"
+#import "TUIGraphicsCache.h"
 #import "TUIHostView.h"
 #import "TUIImageView.h"
 #import "TUILabel.h"
@@ -52,8 +57,10 @@
 #import "TUITextEditor.h"
 #import "TUITextField.h"
 #import "TUITextView.h"
+#import "TUITiledView.h"
 #import "TUIView.h"
 #import "TUIView+Layout.h"
+#import "TUIView+Snapshot.h"
 #import "TUIView+TUIBridgedView.h"
 #import "TUIViewController.h"
 #import "TUIViewNSViewContainer.h"
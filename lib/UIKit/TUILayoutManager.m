@@ -1,6 +1,7 @@
 #import "TUILayoutConstraint.h"
 #import "TUILayoutManager.h"
 #import "TUIView+Layout.h"
+#import "TUIView+Private.h"
 
 @interface TUILayoutConstraint ()
 
@@ -85,7 +86,10 @@
 }
 
 - (void)removeAllLayoutConstraints {
+	NSArray *views = [[self.constraints keyEnumerator] allObjects];
 	[self.constraints removeAllObjects];
+	for(TUIView *view in views)
+		[view.superview _subviewConstraintsDidChange];
 }
 
 - (void)processView:(TUIView *)aView {
@@ -162,6 +166,12 @@
 	}
 	
 	[[viewContainer layoutConstraints] addObject:constraint];
+
+	// frame changes of the view and its source are what trigger the constraint
+	view.postsFrameChangedNotifications = YES;
+	if([[constraint sourceName] isEqual:@"superview"])
+		[view.superview _subviewConstraintsDidChange];
+
 	[self beginProcessingView:view];
 }
 
@@ -172,6 +182,8 @@
 	}
 	
 	[[viewContainer layoutConstraints] removeObject:constraint];
+	if([[constraint sourceName] isEqual:@"superview"])
+		[view.superview _subviewConstraintsDidChange];
 	[self beginProcessingView:view];
 }
 
@@ -179,6 +191,7 @@
 	TUILayoutContainer *viewContainer = [self.constraints objectForKey:view];
 	[[viewContainer layoutConstraints] removeAllObjects];
 	[self.constraints removeObjectForKey:view];
+	[view.superview _subviewConstraintsDidChange];
 }
 
 - (NSArray *)layoutConstraintsOnView:(TUIView *)view {
@@ -204,6 +217,8 @@
 			[self.constraints setObject:viewContainer forKey:view];
 		}
 		[viewContainer setLayoutName:name];
+		if(name != nil)
+			view.postsFrameChangedNotifications = YES;
 	}
 }
 
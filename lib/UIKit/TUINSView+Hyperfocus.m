@@ -16,6 +16,7 @@
 
 #import "TUINSView.h"
 #import "TUICGAdditions.h"
+#import "TUIGraphicsCache.h"
 #import "TUINSView+Hyperfocus.h"
 
 @implementation TUINSView (Hyperfocus)
@@ -61,16 +62,12 @@
 			0.0, 0.0, 0.0, 0.55,
 		};
 		
-		CGColorSpaceRef space = CGColorSpaceCreateDeviceRGB();
-		CGGradientRef gradient = CGGradientCreateWithColorComponents(space, components, locations, 3);
+		CGGradientRef gradient = [[TUIGraphicsCache sharedCache] gradientWithColorComponents:components locations:locations count:3];
 		
 //		CGContextSaveGState(ctx);
 //		CGContextClipToRoundRect(ctx, self.rootView.bounds, 9);
 		CGContextDrawRadialGradient(ctx, gradient, center, startRadius, center, endRadius, kCGGradientDrawsBeforeStartLocation | kCGGradientDrawsAfterEndLocation);
 //		CGContextRestoreGState(ctx);
-		
-		CGGradientRelease(gradient);
-		CGColorSpaceRelease(space);
 	};
 	
 	[CATransaction begin];
@@ -23,6 +23,7 @@
 #import "TUIBridgedScrollView.h"
 #import "TUINSView+Hyperfocus.h"
 #import "TUINSView+Private.h"
+#import "TUIHitTestCache.h"
 #import "TUIViewNSViewContainer.h"
 #import "TUITooltipWindow.h"
 
@@ -74,7 +75,11 @@ static NSComparisonResult compareNSViewOrdering (NSView *viewA, NSView *viewB, v
 	}
 }
 
-@interface TUINSView ()
+@interface TUINSView () {
+	// remembers the last hover hit test, since the pointer mostly moves
+	// within the same view
+	TUIHitTestCache *_hoverHitTestCache;
+}
 
 - (void)recalculateNSViewClipping;
 - (void)recalculateNSViewOrdering;
@@ -102,6 +107,7 @@ static NSComparisonResult compareNSViewOrdering (NSView *viewA, NSView *viewB, v
 
 - (void)windowDidResignKey:(NSNotification *)notification;
 - (void)windowDidBecomeKey:(NSNotification *)notification;
+- (void)windowDidDeminiaturize:(NSNotification *)notification;
 - (void)screenProfileOrBackingPropertiesDidChange:(NSNotification *)notification;
 @end
 
@@ -258,6 +264,7 @@ static NSComparisonResult compareNSViewOrdering (NSView *viewA, NSView *viewB, v
 		[[NSNotificationCenter defaultCenter] removeObserver:self name:NSWindowDidBecomeKeyNotification object:self.window];
 		[[NSNotificationCenter defaultCenter] removeObserver:self name:NSWindowDidResignKeyNotification object:self.window];
 		[[NSNotificationCenter defaultCenter] removeObserver:self name:NSWindowDidChangeScreenProfileNotification object:self.window];
+		[[NSNotificationCenter defaultCenter] removeObserver:self name:NSWindowDidDeminiaturizeNotification object:self.window];
 	}
 	
 	CALayer *hostLayer = self.layer;
@@ -291,9 +298,21 @@ static NSComparisonResult compareNSViewOrdering (NSView *viewA, NSView *viewB, v
 		// make sure the window will post NSWindowDidChangeScreenProfileNotification
 		[self.window setDisplaysWhenScreenProfileChanges:YES];
 		[[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(screenProfileOrBackingPropertiesDidChange:) name:NSWindowDidChangeScreenProfileNotification object:self.window];
+		[[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(windowDidDeminiaturize:) name:NSWindowDidDeminiaturizeNotification object:self.window];
 	}
 }
 
+- (void)viewDidUnhide
+{
+	[super viewDidUnhide];
+	[self.rootView ancestorDidLayout];
+}
+
+- (void)windowDidDeminiaturize:(NSNotification *)notification
+{
+	[self.rootView ancestorDidLayout];
+}
+
 - (void)_updateLayerScaleFactor {
 	if([self window] != nil) {
 		CGFloat scale = 1.0f;
@@ -392,9 +411,38 @@ static NSComparisonResult compareNSViewOrdering (NSView *viewA, NSView *viewB, v
 	}
 }
 
+static BOOL TUINSViewHitTestsRootView(TUINSView *view)
+{
+	static IMP viewForEventIMP = NULL;
+	static IMP viewForLocationInWindowIMP = NULL;
+	static IMP localPointIMP = NULL;
+	static IMP viewForLocalPointIMP = NULL;
+	if(!viewForEventIMP) {
+		viewForEventIMP = [TUINSView instanceMethodForSelector:@selector(viewForEvent:)];
+		viewForLocationInWindowIMP = [TUINSView instanceMethodForSelector:@selector(viewForLocationInWindow:)];
+		localPointIMP = [TUINSView instanceMethodForSelector:@selector(localPointForLocationInWindow:)];
+		viewForLocalPointIMP = [TUINSView instanceMethodForSelector:@selector(viewForLocalPoint:)];
+	}
+	return [view methodForSelector:@selector(viewForEvent:)] == viewForEventIMP &&
+		   [view methodForSelector:@selector(viewForLocationInWindow:)] == viewForLocationInWindowIMP &&
+		   [view methodForSelector:@selector(localPointForLocationInWindow:)] == localPointIMP &&
+		   [view methodForSelector:@selector(viewForLocalPoint:)] == viewForLocalPointIMP;
+}
+
 - (void)_updateHoverViewWithEvent:(NSEvent *)event
 {
-	TUIView *_newHoverView = [self viewForEvent:event];
+	TUIView *_newHoverView = nil;
+	
+	if(TUINSViewHitTestsRootView(self)) {
+		if(!_hoverHitTestCache)
+			_hoverHitTestCache = [[TUIHitTestCache alloc] init];
+		
+		NSPoint p = [self localPointForLocationInWindow:[event locationInWindow]];
+		_newHoverView = [_hoverHitTestCache viewAtPoint:p inRootView:_rootView];
+	} else {
+		// a subclass customizes hit testing, so the cache can't stand in for it
+		_newHoverView = [self viewForEvent:event];
+	}
 	
 	if(![[self window] isKeyWindow]) {
 		if(![_newHoverView acceptsFirstMouse:event]) {
@@ -408,6 +456,7 @@ static NSComparisonResult compareNSViewOrdering (NSView *viewA, NSView *viewB, v
 
 - (void)invalidateHover
 {
+	[_hoverHitTestCache invalidate];
 	[self _updateHoverView:nil withEvent:nil];
 }
 
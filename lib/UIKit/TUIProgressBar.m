@@ -17,6 +17,7 @@
 #import "TUIProgressBar.h"
 #import "CAAnimation+TUIExtensions.h"
 #import "TUICGAdditions.h"
+#import "TUIGraphicsCache.h"
 
 NSString *GHUIProgressBarSetNeedsDisplayObservationContext = @"GHUIProgressBarSetNeedsDisplayObservationContext";
 
@@ -294,11 +295,10 @@ void GHUIProgressPatternDrawCallback(void *info, CGContextRef context);
 	animationClippingView.opaque = NO;
 	animationClippingView.backgroundColor = [NSColor clearColor];
 	
-	CGPathRef clipPath = TUICGPathCreateRoundedRect(animationClippingView.bounds, ceil(NSHeight(animationClippingView.bounds) / 2.0));
+	CGSize clipSize = animationClippingView.bounds.size;
 	CAShapeLayer *clipLayer = [[CAShapeLayer alloc] init];
-	clipLayer.path = clipPath;
+	clipLayer.path = [[TUIGraphicsCache sharedCache] roundedRectPathWithSize:clipSize radius:ceil(clipSize.height / 2.0) corners:TUICGRoundedRectCornerAll];
 	animationClippingView.layer.mask = clipLayer;
-	CGPathRelease(clipPath);
 	
 	CGRect animationViewFrame = CGRectMake(NSMinX(animationClippingView.bounds),NSMinY(animationClippingView.bounds), (NSWidth(animationClippingView.bounds) * 2.0), NSHeight(animationClippingView.bounds));
 	self.animationView = [[TUIView alloc] initWithFrame:animationViewFrame];
@@ -0,0 +1,329 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#include "TUIScrollPhysics.h"
+#include <math.h>
+#include <string.h>
+
+// a throw stops when its velocity drops below this, in points per second
+#define TUIScrollPhysicsMinimumVelocity 0.1
+
+// a bounce settles once both its displacement and velocity drop below this
+#define TUIScrollPhysicsBounceRestThreshold 1.0
+
+// a scroll-to finishes once a step moves less than this
+#define TUIScrollPhysicsScrollToRestThreshold 0.1
+
+// hard cap on steps per advance, so a long stall can't hang the caller
+#define TUIScrollPhysicsMaximumSteps 3600
+
+TUIScrollPhysicsParameters TUIScrollPhysicsDefaultParameters(void)
+{
+	TUIScrollPhysicsParameters parameters;
+	parameters.timestep = 1.0 / 60.0;
+	parameters.decelerationRate = 0.88;
+	parameters.bounceTightness = 2.5;
+	parameters.bounceDampiness = 0.35;
+	parameters.bounces = true;
+	return parameters;
+}
+
+static inline double TUIScrollPhysicsClamp(double value, double minimum, double maximum)
+{
+	if (value < minimum) return minimum;
+	if (value > maximum) return maximum;
+	return value;
+}
+
+static inline double TUIScrollPhysicsBounceVelocity(double velocity)
+{
+	const double maximum = 60.0 * 60.0;
+	velocity *= 0.4;
+	return velocity > 0.0 ? fmin(velocity, maximum) : fmax(velocity, -maximum);
+}
+
+static void TUIScrollPhysicsResetAxis(TUIScrollPhysicsAxis *axis)
+{
+	axis->velocity = 0.0;
+	axis->bounce = 0.0;
+	axis->bounceVelocity = 0.0;
+	axis->bouncing = false;
+}
+
+void TUIScrollPhysicsInit(TUIScrollPhysics *physics, TUIScrollPhysicsParameters parameters)
+{
+	memset(physics, 0, sizeof(*physics));
+	physics->parameters = parameters;
+	physics->mode = TUIScrollPhysicsModeNone;
+	physics->minimumOffset = TUIScrollPhysicsVectorMake(-HUGE_VAL, -HUGE_VAL);
+	physics->maximumOffset = TUIScrollPhysicsVectorMake(HUGE_VAL, HUGE_VAL);
+}
+
+void TUIScrollPhysicsSetBounds(TUIScrollPhysics *physics, TUIScrollPhysicsVector minimumOffset, TUIScrollPhysicsVector maximumOffset)
+{
+	physics->minimumOffset = minimumOffset;
+	physics->maximumOffset = maximumOffset;
+}
+
+void TUIScrollPhysicsSetOffset(TUIScrollPhysics *physics, TUIScrollPhysicsVector offset)
+{
+	physics->x.offset = offset.x;
+	physics->y.offset = offset.y;
+}
+
+static void TUIScrollPhysicsBeginAxisThrow(TUIScrollPhysics *physics, TUIScrollPhysicsAxis *axis, double offset, double velocity, double pull, double minimum, double maximum)
+{
+	TUIScrollPhysicsResetAxis(axis);
+	axis->offset = TUIScrollPhysicsClamp(offset, minimum, maximum);
+
+	if (pull != 0.0) {
+		// don't keep throwing further out past the edge we were pulled over
+		if (signbit(velocity) == signbit(pull))
+			velocity = 0.0;
+		if (physics->parameters.bounces) {
+			axis->bouncing = true;
+			axis->bounce = pull;
+			axis->bounceVelocity = TUIScrollPhysicsBounceVelocity(velocity);
+		}
+	}
+
+	axis->velocity = velocity;
+}
+
+void TUIScrollPhysicsBeginThrow(TUIScrollPhysics *physics, TUIScrollPhysicsVector offset, TUIScrollPhysicsVector velocity, TUIScrollPhysicsVector pull, double time)
+{
+	physics->mode = TUIScrollPhysicsModeThrow;
+	physics->time = time;
+	TUIScrollPhysicsBeginAxisThrow(physics, &physics->x, offset.x, velocity.x, pull.x, physics->minimumOffset.x, physics->maximumOffset.x);
+	TUIScrollPhysicsBeginAxisThrow(physics, &physics->y, offset.y, velocity.y, pull.y, physics->minimumOffset.y, physics->maximumOffset.y);
+}
+
+static void TUIScrollPhysicsRetargetAxis(const TUIScrollPhysicsParameters *parameters, TUIScrollPhysicsAxis *axis, double target, double minimum, double maximum)
+{
+	if (axis->bouncing || parameters->decelerationRate >= 1.0)
+		return;
+
+	// invert the geometric series in TUIScrollPhysicsRestingOffsetForAxis()
+	double distance = TUIScrollPhysicsClamp(target, minimum, maximum) - axis->offset;
+	axis->velocity = distance * (1.0 - parameters->decelerationRate) / parameters->timestep;
+}
+
+void TUIScrollPhysicsRetargetThrow(TUIScrollPhysics *physics, TUIScrollPhysicsVector target)
+{
+	if (physics->mode != TUIScrollPhysicsModeThrow)
+		return;
+
+	TUIScrollPhysicsRetargetAxis(&physics->parameters, &physics->x, target.x, physics->minimumOffset.x, physics->maximumOffset.x);
+	TUIScrollPhysicsRetargetAxis(&physics->parameters, &physics->y, target.y, physics->minimumOffset.y, physics->maximumOffset.y);
+
+	if (physics->x.velocity == 0.0 && !physics->x.bouncing && physics->y.velocity == 0.0 && !physics->y.bouncing)
+		physics->mode = TUIScrollPhysicsModeNone;
+}
+
+void TUIScrollPhysicsBeginScrollTo(TUIScrollPhysics *physics, TUIScrollPhysicsVector offset, TUIScrollPhysicsVector destination, double time)
+{
+	physics->mode = TUIScrollPhysicsModeScrollTo;
+	physics->time = time;
+	physics->destination = destination;
+	TUIScrollPhysicsResetAxis(&physics->x);
+	TUIScrollPhysicsResetAxis(&physics->y);
+	physics->x.offset = TUIScrollPhysicsClamp(offset.x, physics->minimumOffset.x, physics->maximumOffset.x);
+	physics->y.offset = TUIScrollPhysicsClamp(offset.y, physics->minimumOffset.y, physics->maximumOffset.y);
+}
+
+void TUIScrollPhysicsStop(TUIScrollPhysics *physics)
+{
+	physics->mode = TUIScrollPhysicsModeNone;
+	TUIScrollPhysicsResetAxis(&physics->x);
+	TUIScrollPhysicsResetAxis(&physics->y);
+}
+
+static void TUIScrollPhysicsStepAxisThrow(const TUIScrollPhysicsParameters *parameters, TUIScrollPhysicsAxis *axis, double minimum, double maximum)
+{
+	const double h = parameters->timestep;
+
+	if (axis->bouncing) {
+		// spring + damper, mass = 1
+		double force = -axis->bounce * parameters->bounceTightness;
+		if (axis->bounce != 0.0)
+			force -= axis->bounceVelocity * parameters->bounceDampiness;
+
+		axis->bounceVelocity += force;
+		axis->bounce += axis->bounceVelocity * h;
+
+		if (fabs(axis->bounceVelocity) < TUIScrollPhysicsBounceRestThreshold && fabs(axis->bounce) < TUIScrollPhysicsBounceRestThreshold) {
+			axis->bouncing = false;
+			axis->bounce = 0.0;
+			axis->bounceVelocity = 0.0;
+		}
+	}
+
+	if (axis->velocity != 0.0) {
+		double offset = axis->offset + axis->velocity * h;
+
+		if (offset < minimum || offset > maximum) {
+			// hit an edge, hand the momentum over to the rubber band
+			offset = TUIScrollPhysicsClamp(offset, minimum, maximum);
+			if (parameters->bounces && !axis->bouncing) {
+				axis->bouncing = true;
+				axis->bounce = 0.0;
+				axis->bounceVelocity = TUIScrollPhysicsBounceVelocity(axis->velocity);
+			}
+			axis->velocity = 0.0;
+		} else {
+			axis->velocity *= parameters->decelerationRate;
+			if (fabs(axis->velocity) < TUIScrollPhysicsMinimumVelocity)
+				axis->velocity = 0.0;
+		}
+
+		axis->offset = offset;
+	}
+}
+
+static void TUIScrollPhysicsStep(TUIScrollPhysics *physics)
+{
+	switch (physics->mode) {
+		case TUIScrollPhysicsModeThrow: {
+			TUIScrollPhysicsStepAxisThrow(&physics->parameters, &physics->x, physics->minimumOffset.x, physics->maximumOffset.x);
+			TUIScrollPhysicsStepAxisThrow(&physics->parameters, &physics->y, physics->minimumOffset.y, physics->maximumOffset.y);
+
+			if (physics->x.velocity == 0.0 && !physics->x.bouncing && physics->y.velocity == 0.0 && !physics->y.bouncing)
+				physics->mode = TUIScrollPhysicsModeNone;
+			break;
+		}
+		case TUIScrollPhysicsModeScrollTo: {
+			const double r = physics->parameters.decelerationRate;
+			double x = physics->x.offset * r + physics->destination.x * (1.0 - r);
+			double y = physics->y.offset * r + physics->destination.y * (1.0 - r);
+			x = TUIScrollPhysicsClamp(x, physics->minimumOffset.x, physics->maximumOffset.x);
+			y = TUIScrollPhysicsClamp(y, physics->minimumOffset.y, physics->maximumOffset.y);
+
+			if (fabs(x - physics->x.offset) < TUIScrollPhysicsScrollToRestThreshold && fabs(y - physics->y.offset) < TUIScrollPhysicsScrollToRestThreshold) {
+				x = TUIScrollPhysicsClamp(physics->destination.x, physics->minimumOffset.x, physics->maximumOffset.x);
+				y = TUIScrollPhysicsClamp(physics->destination.y, physics->minimumOffset.y, physics->maximumOffset.y);
+				physics->mode = TUIScrollPhysicsModeNone;
+			}
+
+			physics->x.offset = x;
+			physics->y.offset = y;
+			break;
+		}
+		case TUIScrollPhysicsModeNone:
+			break;
+	}
+
+	physics->time += physics->parameters.timestep;
+}
+
+bool TUIScrollPhysicsAdvance(TUIScrollPhysics *physics, double time)
+{
+	const double h = physics->parameters.timestep;
+	int steps = 0;
+
+	// the small slop keeps float error from dropping a step that lands
+	// exactly on time
+	while (physics->mode != TUIScrollPhysicsModeNone && physics->time + h <= time + h * 1e-6) {
+		if (++steps > TUIScrollPhysicsMaximumSteps) {
+			physics->time = time;
+			break;
+		}
+		TUIScrollPhysicsStep(physics);
+	}
+
+	if (physics->mode == TUIScrollPhysicsModeNone && physics->time < time)
+		physics->time = time;
+
+	return physics->mode != TUIScrollPhysicsModeNone;
+}
+
+void TUIScrollPhysicsSample(const TUIScrollPhysics *physics, double time, TUIScrollPhysicsVector *offset, TUIScrollPhysicsVector *bounce)
+{
+	TUIScrollPhysicsVector o = TUIScrollPhysicsVectorMake(physics->x.offset, physics->y.offset);
+	TUIScrollPhysicsVector b = TUIScrollPhysicsVectorMake(physics->x.bounce, physics->y.bounce);
+
+	if (physics->mode != TUIScrollPhysicsModeNone) {
+		double alpha = (time - physics->time) / physics->parameters.timestep;
+		if (alpha > 0.0) {
+			if (alpha > 1.0) alpha = 1.0;
+
+			// the next step is a pure function of the current one, so
+			// interpolating towards it adds no latency and stays deterministic
+			TUIScrollPhysics next = *physics;
+			TUIScrollPhysicsStep(&next);
+
+			o.x += (next.x.offset - o.x) * alpha;
+			o.y += (next.y.offset - o.y) * alpha;
+			b.x += (next.x.bounce - b.x) * alpha;
+			b.y += (next.y.bounce - b.y) * alpha;
+		}
+	}
+
+	if (offset) *offset = o;
+	if (bounce) *bounce = b;
+}
+
+TUIScrollPhysicsVector TUIScrollPhysicsOffsetAtTime(const TUIScrollPhysics *physics, double time)
+{
+	TUIScrollPhysics copy = *physics;
+	TUIScrollPhysicsVector offset, bounce;
+
+	TUIScrollPhysicsAdvance(&copy, time);
+	TUIScrollPhysicsSample(&copy, time, &offset, &bounce);
+	return TUIScrollPhysicsVectorMake(offset.x + bounce.x, offset.y + bounce.y);
+}
+
+static double TUIScrollPhysicsRestingOffsetForAxis(const TUIScrollPhysicsParameters *parameters, const TUIScrollPhysicsAxis *axis, double minimum, double maximum)
+{
+	double offset = axis->offset;
+
+	if (axis->velocity != 0.0) {
+		const double r = parameters->decelerationRate;
+		if (r >= 1.0) {
+			offset = axis->velocity > 0.0 ? maximum : minimum;
+		} else {
+			// sum of the geometric series v*h + v*h*r + v*h*r^2 + ...
+			offset += axis->velocity * parameters->timestep / (1.0 - r);
+		}
+	}
+
+	// anything past an edge bounces back to it
+	return TUIScrollPhysicsClamp(offset, minimum, maximum);
+}
+
+TUIScrollPhysicsVector TUIScrollPhysicsPredictedRestingOffset(const TUIScrollPhysics *physics)
+{
+	switch (physics->mode) {
+		case TUIScrollPhysicsModeThrow:
+			return TUIScrollPhysicsVectorMake(TUIScrollPhysicsRestingOffsetForAxis(&physics->parameters, &physics->x, physics->minimumOffset.x, physics->maximumOffset.x),
+											  TUIScrollPhysicsRestingOffsetForAxis(&physics->parameters, &physics->y, physics->minimumOffset.y, physics->maximumOffset.y));
+		case TUIScrollPhysicsModeScrollTo:
+			return TUIScrollPhysicsVectorMake(TUIScrollPhysicsClamp(physics->destination.x, physics->minimumOffset.x, physics->maximumOffset.x),
+											  TUIScrollPhysicsClamp(physics->destination.y, physics->minimumOffset.y, physics->maximumOffset.y));
+		case TUIScrollPhysicsModeNone:
+			break;
+	}
+	return TUIScrollPhysicsVectorMake(physics->x.offset, physics->y.offset);
+}
+
+bool TUIScrollPhysicsIsAnimating(const TUIScrollPhysics *physics)
+{
+	return physics->mode != TUIScrollPhysicsModeNone;
+}
+
+bool TUIScrollPhysicsIsBouncing(const TUIScrollPhysics *physics)
+{
+	return physics->x.bouncing || physics->y.bouncing;
+}
@@ -0,0 +1,147 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#ifndef TUIScrollPhysics_h
+#define TUIScrollPhysics_h
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// TUIScrollPhysics is the throw, rubber band and scroll-to simulation
+// behind TUIScrollView, written as plain C with no AppKit or Core
+// Animation dependencies so it can be run, tested and tuned headless.
+//
+// The simulation always advances in whole steps of a fixed timestep, so
+// a given starting state produces exactly the same trajectory no matter
+// how often, or how irregularly, it is sampled. Positions between steps
+// are interpolated when sampling.
+//
+// All values are in content offset space: an offset is valid when it lies
+// within [minimumOffset, maximumOffset] on each axis, and a positive
+// velocity increases the offset.
+
+typedef struct {
+	double x;
+	double y;
+} TUIScrollPhysicsVector;
+
+static inline TUIScrollPhysicsVector TUIScrollPhysicsVectorMake(double x, double y) {
+	TUIScrollPhysicsVector v = {x, y};
+	return v;
+}
+
+typedef enum {
+	TUIScrollPhysicsModeNone,
+	TUIScrollPhysicsModeThrow,
+	TUIScrollPhysicsModeScrollTo,
+} TUIScrollPhysicsMode;
+
+typedef struct {
+	// Length of one integration step, in seconds. Default 1/60.
+	double timestep;
+
+	// Fraction of the throw velocity kept after each step, and the easing
+	// factor used by scroll-to animations. Default 0.88.
+	double decelerationRate;
+
+	// Spring constant and damping of the rubber band. Defaults 2.5 and 0.35.
+	double bounceTightness;
+	double bounceDampiness;
+
+	// Whether a throw that hits an edge rubber bands past it. Default true.
+	bool bounces;
+} TUIScrollPhysicsParameters;
+
+typedef struct {
+	double offset;          // in-bounds offset along the axis
+	double velocity;        // throw velocity, points per second
+	double bounce;          // rubber band displacement past the edge
+	double bounceVelocity;
+	bool bouncing;
+} TUIScrollPhysicsAxis;
+
+typedef struct {
+	TUIScrollPhysicsParameters parameters;
+	TUIScrollPhysicsMode mode;
+
+	TUIScrollPhysicsVector minimumOffset;
+	TUIScrollPhysicsVector maximumOffset;
+	TUIScrollPhysicsVector destination;
+
+	TUIScrollPhysicsAxis x;
+	TUIScrollPhysicsAxis y;
+
+	// Simulation time of the current state; always a whole number of
+	// timesteps after the animation began.
+	double time;
+} TUIScrollPhysics;
+
+extern TUIScrollPhysicsParameters TUIScrollPhysicsDefaultParameters(void);
+
+// Resets the simulation to rest at the origin with unbounded offsets.
+extern void TUIScrollPhysicsInit(TUIScrollPhysics *physics, TUIScrollPhysicsParameters parameters);
+
+// Updates the valid offset range. May be called mid-animation.
+extern void TUIScrollPhysicsSetBounds(TUIScrollPhysics *physics, TUIScrollPhysicsVector minimumOffset, TUIScrollPhysicsVector maximumOffset);
+
+// Moves the in-bounds offset without touching velocities, e.g. when the
+// offset is changed from outside the simulation mid-animation.
+extern void TUIScrollPhysicsSetOffset(TUIScrollPhysics *physics, TUIScrollPhysicsVector offset);
+
+// Starts a throw from offset, clamped to the current bounds, at the given
+// velocity in points per second.
+// A non-zero pull on an axis is a rubber band displacement the throw
+// starts from (e.g. the user let go while pulled past an edge); that axis
+// bounces back, and any velocity pointing further out is dropped.
+extern void TUIScrollPhysicsBeginThrow(TUIScrollPhysics *physics, TUIScrollPhysicsVector offset, TUIScrollPhysicsVector velocity, TUIScrollPhysicsVector pull, double time);
+
+// Adjusts the velocity of a throw in progress so it comes to rest at
+// target (clamped to the current bounds) instead. Axes that are bouncing
+// still settle on their edge.
+extern void TUIScrollPhysicsRetargetThrow(TUIScrollPhysics *physics, TUIScrollPhysicsVector target);
+
+// Starts easing from offset, clamped to the current bounds, towards
+// destination.
+extern void TUIScrollPhysicsBeginScrollTo(TUIScrollPhysics *physics, TUIScrollPhysicsVector offset, TUIScrollPhysicsVector destination, double time);
+
+// Stops any animation where it is, discarding velocity and bounce.
+extern void TUIScrollPhysicsStop(TUIScrollPhysics *physics);
+
+// Integrates whole timesteps up to time. Returns true while animating.
+extern bool TUIScrollPhysicsAdvance(TUIScrollPhysics *physics, double time);
+
+// Samples the state at time, which should not be before physics->time,
+// interpolating within the current step. Either out pointer may be NULL.
+extern void TUIScrollPhysicsSample(const TUIScrollPhysics *physics, double time, TUIScrollPhysicsVector *offset, TUIScrollPhysicsVector *bounce);
+
+// The visible offset (in-bounds offset plus rubber band) at any time at or
+// after physics->time. The simulation itself is not advanced.
+extern TUIScrollPhysicsVector TUIScrollPhysicsOffsetAtTime(const TUIScrollPhysics *physics, double time);
+
+// Where the current animation will come to rest.
+extern TUIScrollPhysicsVector TUIScrollPhysicsPredictedRestingOffset(const TUIScrollPhysics *physics);
+
+extern bool TUIScrollPhysicsIsAnimating(const TUIScrollPhysics *physics);
+extern bool TUIScrollPhysicsIsBouncing(const TUIScrollPhysics *physics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
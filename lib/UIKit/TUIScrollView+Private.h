@@ -15,6 +15,10 @@ static NSTimeInterval const TUIScrollerFadeSpeed = 0.25f;
 - (void)_updateScrollers;
 - (void)_updateScrollersAnimated:(BOOL)animated;
 
+// Subclass hooks; the default implementations do nothing.
+- (void)_throwWillEndAtContentOffset:(CGPoint)targetContentOffset;
+- (void)_scrollAnimationDidEnd;
+
 @end
 
 @interface TUIScroller ()
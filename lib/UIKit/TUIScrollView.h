@@ -46,6 +46,7 @@ typedef enum {
 
 @protocol TUIScrollViewDelegate;
 
+@class TUIFrameClock;
 @class TUIScroller;
 
 /**
@@ -79,33 +80,26 @@ typedef enum {
 	
 	__unsafe_unretained id _delegate;
 	
-	CVDisplayLinkRef displayLink;
+	TUIFrameClock *frameClock;
 	CGPoint destinationOffset;
 	CGPoint unfixedContentOffset;
 	
 	float decelerationRate;
 	
+	CGFloat _zoomScale;
+	CGFloat _minimumZoomScale;
+	CGFloat _maximumZoomScale;
+
 	struct {
 		float dx;
 		float dy;
-		CFAbsoluteTime t;
+		CFTimeInterval t;
 	} _lastScroll;
 	
-	struct {
-		float vx;
-		float vy;
-		CFAbsoluteTime t;
-		BOOL throwing;
-	} _throw;
+	CGPoint _pendingScrollOffset;
 	
-	struct {
-		float x;
-		float y;
-		float vx;
-		float vy;
-		CFAbsoluteTime t;
-		BOOL bouncing;
-	} _bounce;
+	CGPoint _physicsOffset;
+	CGPoint _bounceOffset;
 	
   struct {
     float x;
@@ -127,6 +121,9 @@ typedef enum {
 		unsigned int mouseDownInScroller:1;
 		unsigned int ignoreNextScrollPhaseNormal_10_7:1;
 		unsigned int gestureBegan:1;
+		unsigned int throwing:1;
+		unsigned int wheelCoalescing:1;
+		unsigned int wheelPending:1;
 		unsigned int animationMode:2;
 		unsigned int scrollDisabled:1;
 		unsigned int scrollIndicatorStyle:2;
@@ -139,7 +136,10 @@ typedef enum {
 		unsigned int delegateScrollViewDidScroll:1;
 		unsigned int delegateScrollViewWillBeginDragging:1;
 		unsigned int delegateScrollViewDidEndDragging:1;
+		unsigned int delegateScrollViewWillEndDraggingWithVelocityTargetContentOffset:1;
 		unsigned int delegateScrollViewDidEndDecelerating:1;
+		unsigned int delegateViewForZoomingInScrollView:1;
+		unsigned int delegateScrollViewDidZoom:1;
 		unsigned int delegateScrollViewWillShowScrollIndicator:1;
 		unsigned int delegateScrollViewDidShowScrollIndicator:1;
 		unsigned int delegateScrollViewWillHideScrollIndicator:1;
@@ -163,6 +163,15 @@ typedef enum {
 @property (nonatomic) TUIScrollViewIndicatorStyle scrollIndicatorStyle;
 @property (nonatomic) float decelerationRate;
 
+// Pinch to zoom is enabled when maximumZoomScale is greater than
+// minimumZoomScale and the delegate returns a view from
+// -viewForZoomingInScrollView:. That view is scaled with a transform,
+// pinned to the content origin, and contentSize follows its scaled size.
+// All three default to 1.0.
+@property (nonatomic) CGFloat minimumZoomScale;
+@property (nonatomic) CGFloat maximumZoomScale;
+@property (nonatomic) CGFloat zoomScale;
+
 @property (nonatomic, readonly) CGRect visibleRect;
 @property (nonatomic, readonly) TUIEdgeInsets scrollIndicatorInsets;
 
@@ -182,6 +191,10 @@ typedef enum {
 - (void)scrollToTopAnimated:(BOOL)animated;
 - (void)scrollToBottomAnimated:(BOOL)animated;
 
+// Zooms keeping the given point, in the scroll view's frame coordinates,
+// over the same spot in the content.
+- (void)setZoomScale:(CGFloat)scale aroundPoint:(CGPoint)point;
+
 - (void)beginContinuousScrollForDragAtPoint:(CGPoint)dragLocation animated:(BOOL)animated;
 - (void)endContinuousScrollAnimated:(BOOL)animated;
 
@@ -197,8 +210,17 @@ typedef enum {
 - (void)scrollViewDidScroll:(TUIScrollView *)scrollView;
 - (void)scrollViewWillBeginDragging:(TUIScrollView *)scrollView;
 - (void)scrollViewDidEndDragging:(TUIScrollView *)scrollView;
+
+// Sent when the user lets go and the content is thrown. velocity is in
+// points per second in content offset space, and targetContentOffset is
+// where the content is predicted to come to rest. Change it to have the
+// throw land somewhere else instead, e.g. on a row boundary.
+- (void)scrollViewWillEndDragging:(TUIScrollView *)scrollView withVelocity:(CGPoint)velocity targetContentOffset:(inout CGPoint *)targetContentOffset;
 - (void)scrollViewDidEndDecelerating:(TUIScrollView *)scrollView;
 
+- (TUIView *)viewForZoomingInScrollView:(TUIScrollView *)scrollView;
+- (void)scrollViewDidZoom:(TUIScrollView *)scrollView;
+
 - (void)scrollView:(TUIScrollView *)scrollView willShowScrollIndicator:(TUIScrollViewIndicator)indicator;
 - (void)scrollView:(TUIScrollView *)scrollView didShowScrollIndicator:(TUIScrollViewIndicator)indicator;
 - (void)scrollView:(TUIScrollView *)scrollView willHideScrollIndicator:(TUIScrollViewIndicator)indicator;
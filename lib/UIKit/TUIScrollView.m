@@ -16,8 +16,10 @@
 
 #import <CoreServices/CoreServices.h>
 #import "TUIScrollView+Private.h"
+#import "TUIFrameClock.h"
 #import "TUIKit.h"
 #import "TUIScroller.h"
+#import "TUIScrollPhysics.h"
 
 #define KNOB_Z_POSITION 6000
 
@@ -40,7 +42,9 @@ enum {
 	AnimationModeScrollContinuous,
 };
 
-@interface TUIScrollView ()
+@interface TUIScrollView () {
+	TUIScrollPhysics _physics;
+}
 
 @property (nonatomic, strong, readwrite) TUIScroller *verticalScroller;
 @property (nonatomic, strong, readwrite) TUIScroller *horizontalScroller;
@@ -50,8 +54,10 @@ enum {
 - (BOOL)_horizontalScrollerNeededForContentSize:(CGSize)size;
 - (void)_updateScrollers;
 - (void)_updateScrollersAnimated:(BOOL)animated;
-- (void)_updateBounce;
-- (void)_startDisplayLink:(int)scrollMode;
+- (void)_updatePhysicsBounds;
+- (void)_startFrameClock:(int)scrollMode;
+- (void)_flushPendingScroll;
+- (CGPoint)_contentOffset:(CGPoint)o afterWheelDeltaX:(double)dx y:(double)dy;
 
 @end
 
@@ -109,6 +115,10 @@ static BOOL isAtleastMountainLion = NO;
 		_layer.masksToBounds = NO; // differs from UIKit
 		
 		decelerationRate = 0.88;
+		_zoomScale = 1.0;
+		_minimumZoomScale = 1.0;
+		_maximumZoomScale = 1.0;
+		TUIScrollPhysicsInit(&_physics, TUIScrollPhysicsDefaultParameters());
 		
 		_scrollViewFlags.bounceEnabled = [self.class requiresElasticSrolling];
 		_scrollViewFlags.alwaysBounceVertical = NO;
@@ -120,14 +130,14 @@ static BOOL isAtleastMountainLion = NO;
 		
 		self.horizontalScroller = [[TUIScroller alloc] initWithFrame:CGRectZero];
 		self.horizontalScroller.scrollView = self;
-		self.horizontalScroller.layer.zPosition = KNOB_Z_POSITION;
+		self.horizontalScroller.zPosition = KNOB_Z_POSITION;
 		self.horizontalScroller.hidden = YES;
 		self.horizontalScroller.opaque = NO;
 		[self addSubview:self.horizontalScroller];
 		
 		self.verticalScroller = [[TUIScroller alloc] initWithFrame:CGRectZero];
 		self.verticalScroller.scrollView = self;
-		self.verticalScroller.layer.zPosition = KNOB_Z_POSITION;
+		self.verticalScroller.zPosition = KNOB_Z_POSITION;
 		self.verticalScroller.hidden = YES;
 		self.verticalScroller.opaque = NO;
 		[self addSubview:self.verticalScroller];
@@ -137,9 +147,7 @@ static BOOL isAtleastMountainLion = NO;
 
 - (void)dealloc
 {
-	if (displayLink) {
-		CVDisplayLinkRelease(displayLink);
-	}
+	[frameClock removeTarget:self];
 }
 
 - (id<TUIScrollViewDelegate>)delegate
@@ -153,7 +161,10 @@ static BOOL isAtleastMountainLion = NO;
 	_scrollViewFlags.delegateScrollViewDidScroll = [_delegate respondsToSelector:@selector(scrollViewDidScroll:)];
 	_scrollViewFlags.delegateScrollViewWillBeginDragging = [_delegate respondsToSelector:@selector(scrollViewWillBeginDragging:)];
 	_scrollViewFlags.delegateScrollViewDidEndDragging = [_delegate respondsToSelector:@selector(scrollViewDidEndDragging:)];
+	_scrollViewFlags.delegateScrollViewWillEndDraggingWithVelocityTargetContentOffset = [_delegate respondsToSelector:@selector(scrollViewWillEndDragging:withVelocity:targetContentOffset:)];
 	_scrollViewFlags.delegateScrollViewDidEndDecelerating = [_delegate respondsToSelector:@selector(scrollViewDidEndDecelerating:)];
+	_scrollViewFlags.delegateViewForZoomingInScrollView = [_delegate respondsToSelector:@selector(viewForZoomingInScrollView:)];
+	_scrollViewFlags.delegateScrollViewDidZoom = [_delegate respondsToSelector:@selector(scrollViewDidZoom:)];
 	_scrollViewFlags.delegateScrollViewWillShowScrollIndicator = [_delegate respondsToSelector:@selector(scrollView:willShowScrollIndicator:)];
 	_scrollViewFlags.delegateScrollViewDidShowScrollIndicator = [_delegate respondsToSelector:@selector(scrollView:didShowScrollIndicator:)];
 	_scrollViewFlags.delegateScrollViewWillHideScrollIndicator = [_delegate respondsToSelector:@selector(scrollView:willHideScrollIndicator:)];
@@ -290,39 +301,81 @@ static BOOL isAtleastMountainLion = NO;
 	return TUIEdgeInsetsMake(0, 0, (_scrollViewFlags.horizontalScrollIndicatorShowing) ? self.horizontalScroller.frame.size.height : 0, (_scrollViewFlags.verticalScrollIndicatorShowing) ? self.verticalScroller.frame.size.width : 0);
 }
 
-static CVReturn scrollCallback(CVDisplayLinkRef displayLink, const CVTimeStamp *now, const CVTimeStamp *outputTime, CVOptionFlags flagsIn, CVOptionFlags *flagsOut, void *displayLinkContext)
+- (void)_attachFrameClock
 {
-	@autoreleasepool {
-		// perform drawing on the main thread
-		TUIScrollView *scrollView = (__bridge id)displayLinkContext;
-		[scrollView performSelectorOnMainThread:@selector(tick) withObject:nil waitUntilDone:NO];
+	if (!frameClock) {
+		frameClock = [TUIFrameClock addTarget:self action:@selector(tick:) forWindow:self.nsWindow];
 	}
-	return kCVReturnSuccess;
 }
 
-- (void)_startDisplayLink:(int)scrollMode
+- (void)_detachFrameClock
+{
+	[frameClock removeTarget:self];
+	frameClock = nil;
+}
+
+- (void)_startFrameClock:(int)scrollMode
 {
 	_scrollViewFlags.animationMode = scrollMode;
-	_throw.t = CFAbsoluteTimeGetCurrent();
-	_bounce.bouncing = NO;
-	
-	if (!displayLink) {
-		CVDisplayLinkCreateWithActiveCGDisplays(&displayLink);
-		CVDisplayLinkSetOutputCallback(displayLink, &scrollCallback, (__bridge void *)self);
-		CVDisplayLinkSetCurrentCGDisplay(displayLink, kCGDirectMainDisplay);
-	}
-	CVDisplayLinkStart(displayLink);
+	[self _attachFrameClock];
 }
 
-- (void)_stopDisplayLink
+- (void)_stopFrameClock
 {
-	if (displayLink) {
-		CVDisplayLinkStop(displayLink);
-	}
+	BOOL wasAnimating = (_scrollViewFlags.animationMode != AnimationModeNone);
+
+	// wheel input waiting for the next frame still needs the clock
+	if (!_scrollViewFlags.wheelCoalescing)
+		[self _detachFrameClock];
+
 	_scrollViewFlags.animationMode = AnimationModeNone;
-	_bounce.bouncing = 0;
-	[self _updateBounce];
+	TUIScrollPhysicsStop(&_physics);
+	_bounceOffset = CGPointZero;
 	[self _updateScrollersAnimated:NO];
+
+	if (wasAnimating)
+		[self _scrollAnimationDidEnd];
+}
+
+/**
+ * @internal
+ * @brief Drop any wheel input waiting for the next frame
+ */
+- (void)_cancelPendingScroll
+{
+	_scrollViewFlags.wheelPending = 0;
+	_scrollViewFlags.wheelCoalescing = 0;
+}
+
+/**
+ * @internal
+ * @brief Apply the content offset wheel input has arrived at since the last frame
+ *
+ * Each event is run through the rubber band as it arrives, so pulling
+ * resists the same however many events land in a frame; only setting the
+ * resulting offset is coalesced.
+ *
+ * Called once per frame from #tick:, and directly whenever the order of wheel
+ * input matters (gesture and momentum phase changes, explicit offset changes)
+ * so nothing queued is applied out of sequence.
+ */
+- (void)_flushPendingScroll
+{
+	if (!_scrollViewFlags.wheelPending)
+		return;
+
+	_scrollViewFlags.wheelPending = 0;
+	[self setContentOffset:_pendingScrollOffset];
+}
+
+- (void)_throwWillEndAtContentOffset:(CGPoint)targetContentOffset
+{
+	// for subclasses
+}
+
+- (void)_scrollAnimationDidEnd
+{
+	// for subclasses
 }
 
 - (void)willMoveToWindow:(TUINSWindow *)newWindow
@@ -330,7 +383,8 @@ static CVReturn scrollCallback(CVDisplayLinkRef displayLink, const CVTimeStamp *
 	[super willMoveToWindow:newWindow];
 	if (!newWindow) {
 		x = YES;
-		[self _stopDisplayLink];
+		[self _cancelPendingScroll];
+		[self _stopFrameClock];
 	}
 }
 
@@ -640,7 +694,7 @@ static CGPoint PointLerp(CGPoint a, CGPoint b, CGFloat t)
 - (CGPoint)bounceOffset
 {
 	if (_scrollViewFlags.bounceEnabled){
-		return _bounce.bouncing ? CGPointMake(_bounce.x, _bounce.y) : CGPointZero;
+		return _bounceOffset;
 	}else{
 		return CGPointZero;
 	}
@@ -679,14 +733,14 @@ static CGPoint PointLerp(CGPoint a, CGPoint b, CGFloat t)
 }
 
 - (BOOL)isBouncing {
-	return _bounce.bouncing;
+	return TUIScrollPhysicsIsBouncing(&_physics);
 }
 
 - (void)stopThrowing {
 	if (_scrollViewFlags.animationMode == AnimationModeThrow) {
-		// ignore - let the bounce finish (_updateBounce will kill the display link when it's ready)
-		if (!_bounce.bouncing)
-			[self _stopDisplayLink];
+		// ignore - let the bounce finish (tick: will stop the frame clock when it's ready)
+		if (!TUIScrollPhysicsIsBouncing(&_physics))
+			[self _stopFrameClock];
 	}
 }
 
@@ -762,20 +816,24 @@ static CGPoint PointLerp(CGPoint a, CGPoint b, CGFloat t)
 
 - (BOOL)isScrollingToTop
 {
-	if (displayLink) {
-		if (_scrollViewFlags.animationMode == AnimationModeScrollTo) {
-			if (roundf(destinationOffset.y) == roundf([self topDestinationOffset]))
-				return YES;
-		}
+	if (_scrollViewFlags.animationMode == AnimationModeScrollTo) {
+		if (roundf(destinationOffset.y) == roundf([self topDestinationOffset]))
+			return YES;
 	}
 	return NO;
 }
 
 - (void)setContentOffset:(CGPoint)contentOffset animated:(BOOL)animated
 {
+	[self _flushPendingScroll];
+
 	if (animated) {
 		destinationOffset = contentOffset;
-		[self _startDisplayLink:AnimationModeScrollTo];
+		[self _updatePhysicsBounds];
+		TUIScrollPhysicsBeginScrollTo(&_physics, TUIScrollPhysicsVectorMake(_unroundedContentOffset.x, _unroundedContentOffset.y),
+									  TUIScrollPhysicsVectorMake(contentOffset.x, contentOffset.y), CACurrentMediaTime());
+		_physicsOffset = _unroundedContentOffset;
+		[self _startFrameClock:AnimationModeScrollTo];
 	} else {
 		destinationOffset = contentOffset;
 		[self setContentOffset:contentOffset];
@@ -797,7 +855,8 @@ static CGPoint PointLerp(CGPoint a, CGPoint b, CGFloat t)
 		// note the drag offset
 		_dragScrollLocation = dragLocation;
 		// begin a continuous scroll
-		[self _startDisplayLink:AnimationModeScrollContinuous];
+		TUIScrollPhysicsStop(&_physics);
+		[self _startFrameClock:AnimationModeScrollContinuous];
 	}else{
 		[self endContinuousScrollAnimated:animated];
 	}
@@ -812,127 +871,78 @@ static CGPoint PointLerp(CGPoint a, CGPoint b, CGFloat t)
  */
 - (void)endContinuousScrollAnimated:(BOOL)animated {
 	if (_scrollViewFlags.animationMode == AnimationModeScrollContinuous){
-		[self _stopDisplayLink];
+		[self _stopFrameClock];
 	}
 }
 
-static float clampBounce(float x) {
-	x *= 0.4;
-	float m = 60 * 60;
-	if (x > 0.0f)
-		return MIN(x, m);
-	else
-		return MAX(x, -m);
-}
-
-- (void)_startBounce
+/**
+ * @internal
+ * @brief Keep the physics simulation's bounds and tuning in sync with the scroll view
+ */
+- (void)_updatePhysicsBounds
 {
-	if (!_bounce.bouncing) {
-		_bounce.bouncing = YES;
-		_bounce.x = 0.0f;
-		_bounce.y = 0.0f;
-		_bounce.vx = clampBounce( _throw.vx);
-		_bounce.vy = clampBounce(-_throw.vy);
-		_bounce.t = _throw.t;
-	}
-}
+	// _fixProposedContentOffset: decides what's in bounds, so ask it for the extremes
+	CGPoint minimum = [self _fixProposedContentOffset:CGPointMake(-CGFLOAT_MAX, -CGFLOAT_MAX)];
+	CGPoint maximum = [self _fixProposedContentOffset:CGPointMake(CGFLOAT_MAX, CGFLOAT_MAX)];
+	TUIScrollPhysicsSetBounds(&_physics, TUIScrollPhysicsVectorMake(minimum.x, minimum.y), TUIScrollPhysicsVectorMake(maximum.x, maximum.y));
 
-- (void)_updateBounce
-{
-	if (_bounce.bouncing) {
-		CFAbsoluteTime t = CFAbsoluteTimeGetCurrent();
-		double dt = t - _bounce.t;
-		
-		CGPoint F = CGPointZero;
-		
-		float tightness = 2.5f;
-		float dampiness = 0.35f;
-		
-		// spring
-		F.x = -_bounce.x * tightness;
-		F.y = -_bounce.y * tightness;
-		
-		// damper
-		if (fabsf(_bounce.x) > 0.0)
-			F.x -= _bounce.vx * dampiness;
-		if (fabsf(_bounce.y) > 0.0)
-			F.y -= _bounce.vy * dampiness;
-		
-		_bounce.vx += F.x; // mass=1
-		_bounce.vy += F.y;
-		
-		_bounce.x += _bounce.vx * dt;
-		_bounce.y += _bounce.vy * dt;
-		
-		_bounce.t = t;
-		
-		if (fabsf(_bounce.vy) < 1.0 && fabsf(_bounce.y) < 1.0 && fabsf(_bounce.vx) < 1.0 && fabsf(_bounce.x) < 1.0) {
-			[self _stopDisplayLink];
-			if (_scrollViewFlags.delegateScrollViewDidEndDecelerating) {
-				[_delegate scrollViewDidEndDecelerating:self];
-			}
-		}
-		
-		[self _updateScrollers];
-	}
+	_physics.parameters.decelerationRate = decelerationRate;
+	_physics.parameters.bounces = _scrollViewFlags.bounceEnabled;
 }
 
-- (void)tick
+- (void)tick:(TUIFrameClock *)clock
 {
-	[self _updateBounce]; // can't do after _startBounce otherwise dt will be crazy
-	
 	if (self.nsWindow == nil) {
 		NSLog(@"Warning: no window %d (should be 1)", x);
-		[self _stopDisplayLink];
+		[self _cancelPendingScroll];
+		[self _stopFrameClock];
 		return;
 	}
 	
+	if (_scrollViewFlags.wheelCoalescing) {
+		if (_scrollViewFlags.wheelPending) {
+			[self _flushPendingScroll];
+		} else {
+			// the wheel went quiet for a whole frame
+			_scrollViewFlags.wheelCoalescing = 0;
+			if (_scrollViewFlags.animationMode == AnimationModeNone) {
+				[self _detachFrameClock];
+				return;
+			}
+		}
+	}
+
 	switch (_scrollViewFlags.animationMode) {
-		case AnimationModeThrow: {
+		case AnimationModeThrow:
+		case AnimationModeScrollTo: {
+			[self _updatePhysicsBounds];
 			
-			CGPoint o = _unroundedContentOffset;
-			CFAbsoluteTime t = CFAbsoluteTimeGetCurrent();
-			double dt = t - _throw.t;
-			o.x = o.x + _throw.vx * dt;
-			o.y = o.y - _throw.vy * dt;
+			// the offset was changed out from under us, carry on from there
+			if (!CGPointEqualToPoint(_unroundedContentOffset, _physicsOffset))
+				TUIScrollPhysicsSetOffset(&_physics, TUIScrollPhysicsVectorMake(_unroundedContentOffset.x, _unroundedContentOffset.y));
 			
-			CGPoint fixedOffset = [self _fixProposedContentOffset:o];
-			if (!CGPointEqualToPoint(fixedOffset, o)) {
-				[self _startBounce];
-			}
+			CFTimeInterval t = clock.targetTimestamp;
+			BOOL animating = TUIScrollPhysicsAdvance(&_physics, t);
 			
-			[self setContentOffset:o];
+			TUIScrollPhysicsVector offset, bounce;
+			TUIScrollPhysicsSample(&_physics, t, &offset, &bounce);
+			_bounceOffset = CGPointMake(bounce.x, bounce.y);
+			[self setContentOffset:CGPointMake(offset.x, offset.y)];
+			_physicsOffset = _unroundedContentOffset;
 			
-			_throw.vx *= decelerationRate;
-			_throw.vy *= decelerationRate;
-			_throw.t = t;
+			if (TUIScrollPhysicsIsBouncing(&_physics))
+				[self _updateScrollers];
 			
-			if (_throw.throwing && !self._pulling && !_bounce.bouncing) {
-				// may happen in the case where our we scrolled, then stopped, then lifted finger (didn't do a system-started throw, but display link started anyway to do something else)
-				// todo - handle this before it happens, but keep this sanity check
-				if (MAX(fabsf(_throw.vx), fabsf(_throw.vy)) < 0.1) {
-					[self _stopDisplayLink];
+			if (!animating) {
+				BOOL threw = (_scrollViewFlags.animationMode == AnimationModeThrow);
+				[self _stopFrameClock];
+				if (threw && _scrollViewFlags.delegateScrollViewDidEndDecelerating) {
+					[_delegate scrollViewDidEndDecelerating:self];
 				}
 			}
 			
 			break;
 		}
-		case AnimationModeScrollTo: {
-			
-			CGPoint o = _unroundedContentOffset;
-			CGPoint lastOffset = o;
-			o.x = o.x * decelerationRate + destinationOffset.x * (1-decelerationRate);
-			o.y = o.y * decelerationRate + destinationOffset.y * (1-decelerationRate);
-			o = [self _fixProposedContentOffset:o];
-			[self _setContentOffset:o];
-			
-			if ((fabsf(o.x - lastOffset.x) < 0.1) && (fabsf(o.y - lastOffset.y) < 0.1)) {
-				[self _stopDisplayLink];
-				[self setContentOffset:destinationOffset];
-			}
-			
-			break;
-		}
 		case AnimationModeScrollContinuous: {
 			CGFloat direction;
 			CGFloat distance;
@@ -1045,13 +1055,14 @@ static float clampBounce(float x) {
 
 - (void)beginGestureWithEvent:(NSEvent *)event
 {
+	[self _flushPendingScroll];
 	
 	if (_scrollViewFlags.delegateScrollViewWillBeginDragging){
 		[_delegate scrollViewWillBeginDragging:self];
 	}
 	
 	if (_scrollViewFlags.bounceEnabled) {
-		_throw.throwing = 0;
+		_scrollViewFlags.throwing = 0;
 		_scrollViewFlags.gestureBegan = 1; // this won't happen if window isn't key on 10.6, lame
 	}
 	
@@ -1066,49 +1077,56 @@ static float clampBounce(float x) {
 		}
 	}
 	
-	if (!_throw.throwing) {
-		_throw.throwing = YES;
+	if (!_scrollViewFlags.throwing) {
+		_scrollViewFlags.throwing = 1;
 		
-		CFAbsoluteTime t = CFAbsoluteTimeGetCurrent();
+		CFTimeInterval t = CACurrentMediaTime();
 		CFTimeInterval dt = t - _lastScroll.t;
 		if (dt < 1 / 60.0) dt = 1 / 60.0;
 		
-		_throw.vx = _lastScroll.dx / dt;
-		_throw.vy = _lastScroll.dy / dt;
-		_throw.t = t;
-		
-		[self _startDisplayLink:AnimationModeThrow];
+		// the physics work in content offset space, where y runs opposite to the wheel
+		TUIScrollPhysicsVector velocity = TUIScrollPhysicsVectorMake(_lastScroll.dx / dt, -_lastScroll.dy / dt);
+		TUIScrollPhysicsVector pull = TUIScrollPhysicsVectorMake((_pull.xPulling) ? _pull.x : 0.0, (_pull.yPulling) ? _pull.y : 0.0);
 		
 		BOOL pulling = self._pulling; // prefetch the pulling state before resetting it
-		
-		if (_pull.xPulling) {
-			_pull.xPulling = NO;
-			if (signbit(_throw.vx) != signbit(_pull.x)) _throw.vx = 0.0;
-			[self _startBounce];
-			_bounce.x = _pull.x;
-		}
-		
-		if (_pull.yPulling) {
-			_pull.yPulling = NO;
-			if (signbit(_throw.vy) != signbit(_pull.y)) _throw.vy = 0.0;
-			[self _startBounce];
-			_bounce.y = _pull.y;
-		}
+		_pull.xPulling = NO;
+		_pull.yPulling = NO;
 		
 		if (pulling && _scrollViewFlags.didChangeContentInset){
 			_scrollViewFlags.didChangeContentInset = 0;
-			_bounce.x += _contentInset.left;
-			_bounce.y += _contentInset.top;
+			pull.x += _contentInset.left;
+			pull.y += _contentInset.top;
 			_unroundedContentOffset.x -= _contentInset.left;
 			_unroundedContentOffset.y -= _contentInset.top;
 		}
 		
+		[self _updatePhysicsBounds];
+		TUIScrollPhysicsBeginThrow(&_physics, TUIScrollPhysicsVectorMake(_unroundedContentOffset.x, _unroundedContentOffset.y), velocity, pull, t);
+		_physicsOffset = _unroundedContentOffset;
+
+		TUIScrollPhysicsVector predicted = TUIScrollPhysicsPredictedRestingOffset(&_physics);
+		CGPoint targetContentOffset = CGPointMake(predicted.x, predicted.y);
+
+		if (_scrollViewFlags.delegateScrollViewWillEndDraggingWithVelocityTargetContentOffset) {
+			CGPoint proposedContentOffset = targetContentOffset;
+			[_delegate scrollViewWillEndDragging:self withVelocity:CGPointMake(velocity.x, velocity.y) targetContentOffset:&targetContentOffset];
+
+			if (!CGPointEqualToPoint(targetContentOffset, proposedContentOffset)) {
+				TUIScrollPhysicsRetargetThrow(&_physics, TUIScrollPhysicsVectorMake(targetContentOffset.x, targetContentOffset.y));
+				predicted = TUIScrollPhysicsPredictedRestingOffset(&_physics);
+				targetContentOffset = CGPointMake(predicted.x, predicted.y);
+			}
+		}
+
+		[self _startFrameClock:AnimationModeThrow];
+		[self _throwWillEndAtContentOffset:targetContentOffset];
 	}
 	
 }
 
 - (void)endGestureWithEvent:(NSEvent *)event
 {
+	[self _flushPendingScroll];
 	
 	if (_scrollViewFlags.delegateScrollViewDidEndDragging){
 		[_delegate scrollViewDidEndDragging:self];
@@ -1125,6 +1143,62 @@ static float clampBounce(float x) {
 	
 }
 
+/**
+ * @internal
+ * @brief The content offset a wheel delta moves the given one to, rubber banding past the edges mid-gesture
+ */
+- (CGPoint)_contentOffset:(CGPoint)o afterWheelDeltaX:(double)dx y:(double)dy
+{
+	if (!_pull.xPulling) o.x = o.x + dx;
+	if (!_pull.yPulling) o.y = o.y - dy;
+
+	BOOL xPulling = NO;
+	BOOL yPulling = NO;
+	{
+		CGPoint pull = o;
+		pull.x += ((_pull.xPulling) ? _pull.x : 0);
+		pull.y += ((_pull.yPulling) ? _pull.y : 0);
+		CGPoint fixedOffset = [self _fixProposedContentOffset:pull];
+		o.x = fixedOffset.x;
+		o.y = fixedOffset.y;
+		xPulling = fixedOffset.x != pull.x;
+		yPulling = fixedOffset.y != pull.y;
+	}
+
+	if (_scrollViewFlags.gestureBegan){
+		float maxManualPull = 30.0;
+
+		if (_pull.xPulling){
+			CGFloat xCounter = pow(M_E, -1.0 / maxManualPull * fabsf(_pull.x));
+			// don't counter on un-pull
+			if (signbit(_pull.x) != signbit(dx))
+				xCounter = 1;
+			// update x-axis pulling
+			if (xPulling)
+				_pull.x += dx * xCounter;
+		}else if (xPulling){
+			_pull.x = dx;
+		}
+
+		if (_pull.yPulling){
+			CGFloat yCounter = pow(M_E, -1.0 / maxManualPull * fabsf(_pull.y));
+			// don't counter on un-pull
+			if (signbit(_pull.y) == signbit(dy))
+				yCounter = 1; // don't counter
+			// update y-axis pulling
+			if (yPulling)
+				_pull.y -= dy * yCounter;
+		}else if (yPulling){
+			_pull.y = -dy;
+		}
+
+		_pull.xPulling = xPulling;
+		_pull.yPulling = yPulling;
+	}
+
+	return o;
+}
+
 - (void)scrollWheel:(NSEvent *)event
 {
 	if (_contentSize.height <= CGRectGetHeight(self.bounds)) {
@@ -1169,10 +1243,10 @@ static float clampBounce(float x) {
 				}
 				
 				// in case we are in background, didn't get a beginGesture
-				_throw.throwing = 0;
+				_scrollViewFlags.throwing = 0;
 				_scrollViewFlags.didChangeContentInset = 0;
 				
-				[self _stopDisplayLink];
+				[self _stopFrameClock];
 				CGEventRef cgEvent = [event CGEvent];
 				const int64_t isContinuous = CGEventGetIntegerValueField(cgEvent, kCGScrollWheelEventIsContinuous);
 				
@@ -1202,62 +1276,25 @@ static float clampBounce(float x) {
 				if (MAX(fabsf(dx), fabsf(dy)) > 0.00001) { // ignore 0.0, 0.0
 					_lastScroll.dx = dx;
 					_lastScroll.dy = dy;
-					_lastScroll.t = CFAbsoluteTimeGetCurrent();
+					_lastScroll.t = CACurrentMediaTime();
 				}
 				
-				CGPoint o = _unroundedContentOffset;
-				
-				if (!_pull.xPulling) o.x = o.x + dx;
-				if (!_pull.yPulling) o.y = o.y - dy;
+				CGPoint base = _scrollViewFlags.wheelPending ? _pendingScrollOffset : _unroundedContentOffset;
+				_pendingScrollOffset = [self _contentOffset:base afterWheelDeltaX:dx y:dy];
+				_scrollViewFlags.wheelPending = 1;
 				
-				BOOL xPulling = NO;
-				BOOL yPulling = NO;
-				{
-					CGPoint pull = o;
-					pull.x += ((_pull.xPulling) ? _pull.x : 0);
-					pull.y += ((_pull.yPulling) ? _pull.y : 0);
-					CGPoint fixedOffset = [self _fixProposedContentOffset:pull];
-					o.x = fixedOffset.x;
-					o.y = fixedOffset.y;
-					xPulling = fixedOffset.x != pull.x;
-					yPulling = fixedOffset.y != pull.y;
+				// the first event of a burst is applied right away so nothing waits
+				// on the display; anything arriving before the next frame moves the
+				// pending offset, which is applied once from tick:
+				if (!_scrollViewFlags.wheelCoalescing) {
+					[self _flushPendingScroll];
+					_scrollViewFlags.wheelCoalescing = 1;
+					[self _attachFrameClock];
 				}
-				
-				if (_scrollViewFlags.gestureBegan){
-					float maxManualPull = 30.0;
-					
-					if (_pull.xPulling){
-						CGFloat xCounter = pow(M_E, -1.0 / maxManualPull * fabsf(_pull.x));
-						// don't counter on un-pull
-						if (signbit(_pull.x) != signbit(dx))
-							xCounter = 1;
-						// update x-axis pulling
-						if (xPulling)
-							_pull.x += dx * xCounter;
-					}else if (xPulling){
-						_pull.x = dx;
-					}
-					
-					if (_pull.yPulling){
-						CGFloat yCounter = pow(M_E, -1.0 / maxManualPull * fabsf(_pull.y));
-						// don't counter on un-pull
-						if (signbit(_pull.y) == signbit(dy))
-							yCounter = 1; // don't counter
-						// update y-axis pulling
-						if (yPulling)
-							_pull.y -= dy * yCounter;
-					}else if (yPulling){
-						_pull.y = -dy;
-					}
-					
-					_pull.xPulling = xPulling;
-					_pull.yPulling = yPulling;
-				}
-				
-				[self setContentOffset:o];
 				break;
 			}
 			case ScrollPhaseThrowingBegan: {
+				[self _flushPendingScroll];
 				[self _startThrow];
 				break;
 			}
@@ -1265,11 +1302,12 @@ static float clampBounce(float x) {
 				break;
 			}
 			case ScrollPhaseThrowingEnded: {
+				[self _flushPendingScroll];
 				if (_scrollViewFlags.animationMode == AnimationModeThrow) { // otherwise we may have started a scrollToTop:animated:, don't want to stop that)
-					if (_bounce.bouncing) {
-						// ignore - let the bounce finish (_updateBounce will kill the display link when it's ready)
+					if (TUIScrollPhysicsIsBouncing(&_physics)) {
+						// ignore - let the bounce finish (tick: will stop the frame clock when it's ready)
 					} else {
-						[self _stopDisplayLink];
+						[self _stopFrameClock];
 						if (_scrollViewFlags.delegateScrollViewDidEndDecelerating) {
 							[_delegate scrollViewDidEndDecelerating:self];
 						}
@@ -1281,6 +1319,85 @@ static float clampBounce(float x) {
 	}
 }
 
+- (CGFloat)minimumZoomScale
+{
+	return _minimumZoomScale;
+}
+
+- (void)setMinimumZoomScale:(CGFloat)scale
+{
+	_minimumZoomScale = scale;
+	if (_zoomScale < scale)
+		self.zoomScale = scale;
+}
+
+- (CGFloat)maximumZoomScale
+{
+	return _maximumZoomScale;
+}
+
+- (void)setMaximumZoomScale:(CGFloat)scale
+{
+	_maximumZoomScale = scale;
+	if (_zoomScale > scale)
+		self.zoomScale = scale;
+}
+
+- (CGFloat)zoomScale
+{
+	return _zoomScale;
+}
+
+- (void)setZoomScale:(CGFloat)scale
+{
+	CGRect b = self.bounds;
+	[self setZoomScale:scale aroundPoint:CGPointMake(b.size.width / 2, b.size.height / 2)];
+}
+
+- (void)setZoomScale:(CGFloat)scale aroundPoint:(CGPoint)point
+{
+	scale = MAX(_minimumZoomScale, MIN(scale, _maximumZoomScale));
+	if (scale <= 0.0 || scale == _zoomScale)
+		return;
+
+	TUIView *view = (_scrollViewFlags.delegateViewForZoomingInScrollView) ? [_delegate viewForZoomingInScrollView:self] : nil;
+	if (!view) {
+		_zoomScale = scale;
+		return;
+	}
+
+	// the content point under the anchor, which should stay under it
+	CGPoint offset = self.contentOffset;
+	CGPoint anchor = CGPointMake(point.x - offset.x, point.y - offset.y);
+	CGFloat ratio = scale / _zoomScale;
+	_zoomScale = scale;
+
+	CGSize size = view.bounds.size;
+	view.transform = CGAffineTransformMakeScale(scale, scale);
+	view.center = CGPointMake(size.width * scale / 2, size.height * scale / 2);
+	self.contentSize = CGSizeMake(size.width * scale, size.height * scale);
+
+	[self setContentOffset:CGPointMake(point.x - anchor.x * ratio, point.y - anchor.y * ratio)];
+
+	// the offset may not have moved, but what's visible of the view has
+	[view setNeedsLayout];
+
+	if (_scrollViewFlags.delegateScrollViewDidZoom) {
+		[_delegate scrollViewDidZoom:self];
+	}
+}
+
+- (void)magnifyWithEvent:(NSEvent *)event
+{
+	if (_maximumZoomScale <= _minimumZoomScale || !_scrollViewFlags.delegateViewForZoomingInScrollView) {
+		[super magnifyWithEvent:event];
+		return;
+	}
+
+	[self _stopFrameClock];
+	[self setZoomScale:_zoomScale * (1.0 + [event magnification]) aroundPoint:[self localPointForEvent:event]];
+}
+
 - (void)mouseDown:(NSEvent *)event onSubview:(TUIView *)subview {
 	if (subview == self.verticalScroller || subview == self.horizontalScroller){
 		_scrollViewFlags.mouseDownInScroller = YES;
@@ -0,0 +1,55 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class TUIView;
+
+// Keeps a view's subviews in back to front order (by layer zPosition, then
+// by position in the subviews array) across hit tests, instead of sorting
+// them for every one.
+//
+// Inserting and removing subviews updates the order in place. A change to
+// a subview's zPosition, made through TUIView's zPosition, re-sorts on the
+// next query; nothing is checked per query.
+//
+// With usesSpatialIndex set, it also buckets subviews into a uniform grid
+// by frame, so finding the subviews under a point looks at one cell rather
+// than every subview. The grid is rebuilt after subviews are inserted,
+// removed or reordered, moved through TUIView's geometry setters, or
+// autoresized or laid out by their superview. A query also rebuilds it if
+// any subview in the cell it looks at has moved some other way.
+@interface TUISubviewIndex : NSObject
+
+- (id)initWithView:(TUIView *)view;
+
+@property (nonatomic, assign) BOOL usesSpatialIndex;
+
+// Every subview, back to front. Owned by the index; copy it before
+// changing the view's subviews while enumerating it.
+- (NSArray *)sortedSubviews;
+
+// The subviews that may contain the point (in the view's coordinates),
+// back to front: every subview, or just those whose frames share the
+// point's grid cell when usesSpatialIndex is set.
+- (NSArray *)sortedSubviewsAtPoint:(CGPoint)point;
+
+- (void)didInsertSubview:(TUIView *)subview;
+- (void)didRemoveSubview:(TUIView *)subview;
+- (void)subviewGeometryDidChange;
+- (void)subviewZPositionDidChange;
+
+@end
@@ -0,0 +1,302 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import "TUISubviewIndex.h"
+#import "TUIView.h"
+
+// grid cells hold about this many subviews on average
+#define TUISubviewIndexSubviewsPerCell 4
+#define TUISubviewIndexMaximumGridSide 64
+
+@interface TUISubviewIndex () {
+	__unsafe_unretained TUIView *_view;
+
+	// nil when it must be sorted again from scratch
+	NSMutableArray *_sortedSubviews;
+	// zPosition of each sorted subview when it was placed
+	CGFloat *_zPositions;
+	NSUInteger _zPositionCapacity;
+
+	BOOL _gridValid;
+	CGRect _gridRect;
+	NSUInteger _gridColumns;
+	NSUInteger _gridRows;
+	// cell i holds _cellEntries[_cellStarts[i] ..< _cellStarts[i + 1]],
+	// indexes into _sortedSubviews in ascending (back to front) order
+	NSUInteger *_cellStarts;
+	NSUInteger *_cellEntries;
+	// each sorted subview's frame when the grid was built
+	CGRect *_gridFrames;
+}
+
+- (void)_sort;
+- (void)_reserveZPositions:(NSUInteger)count;
+- (void)_buildGrid;
+- (void)_freeGrid;
+
+@end
+
+@implementation TUISubviewIndex
+
+@synthesize usesSpatialIndex = _usesSpatialIndex;
+
+- (id)initWithView:(TUIView *)view
+{
+	if ((self = [super init])) {
+		_view = view;
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	free(_zPositions);
+	[self _freeGrid];
+}
+
+- (void)setUsesSpatialIndex:(BOOL)usesSpatialIndex
+{
+	_usesSpatialIndex = usesSpatialIndex;
+	if (!usesSpatialIndex)
+		[self _freeGrid];
+	_gridValid = NO;
+}
+
+- (NSArray *)sortedSubviews
+{
+	if (!_sortedSubviews || [_sortedSubviews count] != [_view.subviews count])
+		[self _sort];
+	return _sortedSubviews;
+}
+
+- (NSArray *)sortedSubviewsAtPoint:(CGPoint)point
+{
+	NSArray *sorted = [self sortedSubviews];
+	if (!_usesSpatialIndex)
+		return sorted;
+
+	if (!_gridValid)
+		[self _buildGrid];
+
+	// a subview in the cell that moved behind the index's back (through its
+	// layer, say) means the grid may be wrong anywhere; build it again once
+	for (int attempt = 0; attempt < 2; attempt++) {
+		if (!CGRectContainsPoint(_gridRect, point))
+			return [NSArray array];
+
+		NSUInteger column = MIN(_gridColumns - 1, (NSUInteger)((point.x - _gridRect.origin.x) / _gridRect.size.width * _gridColumns));
+		NSUInteger row = MIN(_gridRows - 1, (NSUInteger)((point.y - _gridRect.origin.y) / _gridRect.size.height * _gridRows));
+		NSUInteger cell = row * _gridColumns + column;
+
+		NSUInteger start = _cellStarts[cell];
+		NSUInteger end = _cellStarts[cell + 1];
+		NSMutableArray *candidates = [NSMutableArray arrayWithCapacity:end - start];
+		BOOL moved = NO;
+		for (NSUInteger i = start; i < end; i++) {
+			TUIView *subview = [sorted objectAtIndex:_cellEntries[i]];
+			if (attempt == 0 && !CGRectEqualToRect(subview.frame, _gridFrames[_cellEntries[i]])) {
+				moved = YES;
+				break;
+			}
+			[candidates addObject:subview];
+		}
+		if (!moved)
+			return candidates;
+
+		[self _buildGrid];
+	}
+	return [NSArray array];
+}
+
+- (void)didInsertSubview:(TUIView *)subview
+{
+	_gridValid = NO;
+	if (!_sortedSubviews)
+		return;
+
+	// find the run of subviews at the same zPosition
+	CGFloat z = subview.layer.zPosition;
+	NSUInteger count = [_sortedSubviews count];
+	NSUInteger lo = 0, hi = count;
+	while (lo < hi) {
+		NSUInteger mid = (lo + hi) / 2;
+		if (_zPositions[mid] < z) lo = mid + 1; else hi = mid;
+	}
+	NSUInteger first = lo;
+	hi = count;
+	while (lo < hi) {
+		NSUInteger mid = (lo + hi) / 2;
+		if (_zPositions[mid] <= z) lo = mid + 1; else hi = mid;
+	}
+	NSUInteger last = lo;
+
+	// within it, subviews stay in subviews array order; placing one that
+	// went anywhere but either end of the array would take a search, so
+	// leave that to a full sort
+	NSUInteger index;
+	NSArray *subviews = _view.subviews;
+	if (first == last || [subviews lastObject] == subview) {
+		index = last;
+	} else if ([subviews count] > 0 && [subviews objectAtIndex:0] == subview) {
+		index = first;
+	} else {
+		_sortedSubviews = nil;
+		return;
+	}
+
+	[self _reserveZPositions:count + 1];
+	memmove(_zPositions + index + 1, _zPositions + index, (count - index) * sizeof(CGFloat));
+	_zPositions[index] = z;
+	[_sortedSubviews insertObject:subview atIndex:index];
+}
+
+- (void)didRemoveSubview:(TUIView *)subview
+{
+	_gridValid = NO;
+	if (!_sortedSubviews)
+		return;
+
+	NSUInteger index = [_sortedSubviews indexOfObjectIdenticalTo:subview];
+	if (index == NSNotFound)
+		return;
+
+	NSUInteger count = [_sortedSubviews count];
+	memmove(_zPositions + index, _zPositions + index + 1, (count - index - 1) * sizeof(CGFloat));
+	[_sortedSubviews removeObjectAtIndex:index];
+}
+
+- (void)subviewGeometryDidChange
+{
+	_gridValid = NO;
+}
+
+- (void)subviewZPositionDidChange
+{
+	_sortedSubviews = nil;
+	_gridValid = NO;
+}
+
+/**
+ * @internal
+ * @brief Sort every subview from scratch
+ */
+- (void)_sort
+{
+	NSArray *sorted = [_view.subviews sortedArrayWithOptions:NSSortStable usingComparator:(NSComparator)^NSComparisonResult(TUIView *a, TUIView *b) {
+		CGFloat x = a.layer.zPosition;
+		CGFloat y = b.layer.zPosition;
+		if(x > y)
+			return NSOrderedDescending;
+		else if(x < y)
+			return NSOrderedAscending;
+		return NSOrderedSame;
+	}];
+
+	_sortedSubviews = [sorted mutableCopy];
+	[self _reserveZPositions:[sorted count]];
+	NSUInteger i = 0;
+	for (TUIView *subview in sorted)
+		_zPositions[i++] = subview.layer.zPosition;
+	_gridValid = NO;
+}
+
+- (void)_reserveZPositions:(NSUInteger)count
+{
+	if (count <= _zPositionCapacity)
+		return;
+	_zPositionCapacity = MAX(count, _zPositionCapacity * 2);
+	_zPositions = realloc(_zPositions, _zPositionCapacity * sizeof(CGFloat));
+}
+
+/**
+ * @internal
+ * @brief Bucket the sorted subviews into a grid over the union of their frames
+ */
+- (void)_buildGrid
+{
+	[self _freeGrid];
+	_gridValid = YES;
+
+	NSUInteger count = [_sortedSubviews count];
+	CGRect *frames = malloc(MAX(1, count) * sizeof(CGRect));
+	_gridFrames = frames;
+	CGRect rect = CGRectNull;
+	NSUInteger i = 0;
+	for (TUIView *subview in _sortedSubviews) {
+		frames[i] = subview.frame;
+		rect = CGRectUnion(rect, frames[i]);
+		i++;
+	}
+
+	NSUInteger side = (NSUInteger)ceil(sqrt((double)count / TUISubviewIndexSubviewsPerCell));
+	side = MAX(1, MIN(side, TUISubviewIndexMaximumGridSide));
+	_gridRect = CGRectIsNull(rect) ? CGRectZero : rect;
+	_gridColumns = side;
+	_gridRows = side;
+
+	NSUInteger cellCount = side * side;
+	_cellStarts = calloc(cellCount + 1, sizeof(NSUInteger));
+
+	CGFloat cellWidth = _gridRect.size.width / side;
+	CGFloat cellHeight = _gridRect.size.height / side;
+
+	// count, then fill, the entries of every cell a frame touches
+	for (int pass = 0; pass < 2; pass++) {
+		NSUInteger *next = NULL;
+		if (pass == 1) {
+			for (NSUInteger c = 0; c < cellCount; c++)
+				_cellStarts[c + 1] += _cellStarts[c];
+			_cellEntries = malloc(MAX(1, _cellStarts[cellCount]) * sizeof(NSUInteger));
+			next = malloc(cellCount * sizeof(NSUInteger));
+			memcpy(next, _cellStarts, cellCount * sizeof(NSUInteger));
+		}
+
+		for (i = 0; i < count; i++) {
+			CGRect f = frames[i];
+			if (CGRectIsEmpty(f) || cellWidth <= 0.0 || cellHeight <= 0.0)
+				continue;
+
+			NSUInteger c0 = MIN(side - 1, (NSUInteger)((CGRectGetMinX(f) - _gridRect.origin.x) / cellWidth));
+			NSUInteger c1 = MIN(side - 1, (NSUInteger)((CGRectGetMaxX(f) - _gridRect.origin.x) / cellWidth));
+			NSUInteger r0 = MIN(side - 1, (NSUInteger)((CGRectGetMinY(f) - _gridRect.origin.y) / cellHeight));
+			NSUInteger r1 = MIN(side - 1, (NSUInteger)((CGRectGetMaxY(f) - _gridRect.origin.y) / cellHeight));
+			for (NSUInteger r = r0; r <= r1; r++) {
+				for (NSUInteger c = c0; c <= c1; c++) {
+					NSUInteger cell = r * side + c;
+					if (pass == 0)
+						_cellStarts[cell + 1]++;
+					else
+						_cellEntries[next[cell]++] = i;
+				}
+			}
+		}
+
+		free(next);
+	}
+}
+
+- (void)_freeGrid
+{
+	free(_cellStarts);
+	free(_cellEntries);
+	free(_gridFrames);
+	_cellStarts = NULL;
+	_cellEntries = NULL;
+	_gridFrames = NULL;
+	_gridValid = NO;
+}
+
+@end
@@ -101,7 +101,7 @@
   // initialize defaults on the first drag
   if(_currentDragToReorderIndexPath == nil || _previousDragToReorderIndexPath == nil){
     // make sure the dragged cell is on top
-    _dragToReorderCell.layer.zPosition = kTUITableViewDraggedCellZPosition;
+    _dragToReorderCell.zPosition = kTUITableViewDraggedCellZPosition;
     // setup index paths
     _currentDragToReorderIndexPath = cell.indexPath;
     _previousDragToReorderIndexPath = cell.indexPath;
@@ -346,7 +346,7 @@
       ];
     }else{
       cell.frame = frame;
-      cell.layer.zPosition = 0;
+      cell.zPosition = 0;
       [self reloadData];
     }
     
@@ -354,7 +354,7 @@
     _currentDragToReorderIndexPath = nil;
     
   }else{
-    cell.layer.zPosition = 0;
+    cell.zPosition = 0;
   }
   
   _previousDragToReorderIndexPath = nil;
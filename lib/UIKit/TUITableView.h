@@ -77,6 +77,16 @@ typedef enum {
 	NSMutableIndexSet           * _visibleSectionHeaders;
 	NSMutableDictionary         * _visibleItems;
 	NSMutableDictionary         * _reusableTableCells;
+	NSMutableDictionary         * _prefetchedItems;
+
+	// range of visibleRect origins over which the visible rows, headers
+	// and footers stay the same, so scrolling needs no layout pass
+	struct {
+		CGFloat minimumY;
+		CGFloat maximumY;
+		CGFloat x;
+		CGFloat width;
+	} _layoutRange;
 	
 	NSIndexPath            * _selectedIndexPath;
 	NSIndexPath            * _indexPathShouldBeFirstResponder;
@@ -102,6 +112,7 @@ typedef enum {
 		unsigned int dataSourceNumberOfSectionsInTableView:1;
 		unsigned int delegateTableViewWillDisplayCellForRowAtIndexPath:1;
 		unsigned int maintainContentOffsetAfterReload:1;
+		unsigned int layoutRangeValid:1;
 	} _tableFlags;
 	
 }
@@ -15,6 +15,7 @@
  */
 
 #import "TUITableView.h"
+#import "TUIScrollView+Private.h"
 #import "TUINSView.h"
 #import "TUINSWindow.h"
 #import "TUITableView+Cell.h"
@@ -134,7 +135,7 @@ typedef struct {
 		if(_tableView.dataSource != nil && [_tableView.dataSource respondsToSelector:@selector(tableView:headerViewForSection:)]){
 			_headerView = [_tableView.dataSource tableView:_tableView headerViewForSection:sectionIndex];
 			_headerView.autoresizingMask = TUIViewAutoresizingFlexibleWidth;
-			_headerView.layer.zPosition = HEADER_Z_POSITION;
+			_headerView.zPosition = HEADER_Z_POSITION;
 		}
 	}
 	return _headerView;
@@ -145,6 +146,9 @@ typedef struct {
 @interface TUITableView (Private)
 - (void)_updateSectionInfo;
 - (void)_updateDerepeaterViews;
+- (void)_recyclePrefetchedCells;
+- (void)_updateLayoutRange;
+- (BOOL)_visibleRectIsWithinLayoutRange;
 @end
 
 @implementation TUITableView
@@ -158,6 +162,7 @@ typedef struct {
 		_reusableTableCells = [[NSMutableDictionary alloc] init];
 		_visibleSectionHeaders = [[NSMutableIndexSet alloc] init];
 		_visibleItems = [[NSMutableDictionary alloc] init];
+		_prefetchedItems = [[NSMutableDictionary alloc] init];
 		_tableFlags.animateSelectionChanges = 1;
 	}
 	return self;
@@ -304,6 +309,7 @@ typedef struct {
 		array = [[NSMutableArray alloc] init];
 		[_reusableTableCells setObject:array forKey:identifier];
 	}
+	[cell discardContents];
 	[array addObject:cell];
 }
 
@@ -629,6 +635,7 @@ static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
 
 - (void)setPullDownView:(TUIView *)p
 {
+	_tableFlags.layoutRangeValid = 0;
 	[_pullDownView removeFromSuperview];
 	
 	_pullDownView = p;
@@ -639,6 +646,7 @@ static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
 
 - (void)setHeaderView:(TUIView *)h
 {
+	_tableFlags.layoutRangeValid = 0;
 	[self.headerView removeFromSuperview];
 	
 	_headerView = h;
@@ -648,6 +656,7 @@ static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
 }
 
 - (void)setFooterView:(TUIView *)footerView {
+	_tableFlags.layoutRangeValid = 0;
 	[self.footerView removeFromSuperview];
 	_footerView = footerView;
 	
@@ -691,6 +700,7 @@ static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
 			}
 		}
 		
+		[self _recyclePrefetchedCells]; // row frames may be about to change
 		[self _updateSectionInfo]; // clean up any previous section info and recreate it
 		self.contentSize = CGSizeMake(self.bounds.size.width, _contentHeight);
 		
@@ -805,7 +815,7 @@ static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
 		for(NSIndexPath *i in _visibleItems) {
 			TUITableViewCell *cell = [_visibleItems objectForKey:i];
 			cell.frame = [self rectForRowAtIndexPath:i];
-			cell.layer.zPosition = 0;
+			cell.zPosition = 0;
 			[cell setNeedsLayout];
 		}
 	}
@@ -843,11 +853,17 @@ static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
 		if([_visibleItems objectForKey:i]) {
 			NSLog(@"!!! Warning: already have a cell in place for index path %@\n\n\n", i);
 		} else {
-			TUITableViewCell *cell = [_dataSource tableView:self cellForRowAtIndexPath:i];
+			TUITableViewCell *cell = [_prefetchedItems objectForKey:i];
+			if(cell) {
+				[_prefetchedItems removeObjectForKey:i];
+				cell.hidden = NO;
+			} else {
+				cell = [_dataSource tableView:self cellForRowAtIndexPath:i];
+			}
 			[self.nsView invalidateHoverForView:cell];
 			
 			cell.frame = [self rectForRowAtIndexPath:i];
-			cell.layer.zPosition = 0;
+			cell.zPosition = 0;
 			
 			[cell setNeedsLayout];
 			[cell prepareForDisplay];
@@ -862,7 +878,9 @@ static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
 				[_delegate tableView:self willDisplayCell:cell forRowAtIndexPath:i];
 			}
 			
-			[self addSubview:cell];
+			if(cell.superview != self) {
+				[self addSubview:cell];
+			}
 			
 			if([_indexPathShouldBeFirstResponder isEqual:i]) {
 			  // only make cells first responder if they accept it
@@ -921,6 +939,72 @@ static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
 	}
 }
 
+/**
+ * @internal
+ * @brief Materialize and render the rows a throw is going to come to rest on
+ *
+ * Cells for rows at the destination are created up front, added hidden and
+ * drawn, so that when the throw arrives _layoutCells: can just reveal them.
+ */
+- (void)_throwWillEndAtContentOffset:(CGPoint)targetContentOffset
+{
+	[super _throwWillEndAtContentOffset:targetContentOffset];
+	[self _recyclePrefetchedCells];
+
+	CGRect visible = [self visibleRect];
+	CGRect destination = visible;
+	destination.origin = CGPointMake(-targetContentOffset.x, -targetContentOffset.y);
+	if(CGRectContainsRect(visible, destination))
+		return;
+
+	[TUIView setAnimationsEnabled:NO block:^{
+		[CATransaction begin];
+		[CATransaction setDisableActions:YES];
+
+		for(NSIndexPath *i in [self indexPathsForRowsInRect:destination]) {
+			CGRect cellRect = [self rectForRowAtIndexPath:i];
+			if([_visibleItems objectForKey:i] || CGRectIntersectsRect(cellRect, visible))
+				continue; // _layoutCells: is going to handle it anyway
+
+			TUITableViewCell *cell = [_dataSource tableView:self cellForRowAtIndexPath:i];
+			if(!cell)
+				continue;
+
+			cell.frame = cellRect;
+			cell.zPosition = 0;
+			cell.hidden = YES;
+			[cell setNeedsLayout];
+			[cell prepareForDisplay];
+			[self addSubview:cell];
+
+			[cell layoutIfNeeded];
+			[cell displayIfNeeded];
+
+			[_prefetchedItems setObject:cell forKey:i];
+		}
+
+		[CATransaction commit];
+	}];
+}
+
+- (void)_scrollAnimationDidEnd
+{
+	[super _scrollAnimationDidEnd];
+	[self layoutIfNeeded]; // adopt anything that just came into view first
+	[self _recyclePrefetchedCells];
+}
+
+- (void)_recyclePrefetchedCells
+{
+	for(NSIndexPath *i in _prefetchedItems) {
+		TUITableViewCell *cell = [_prefetchedItems objectForKey:i];
+		[cell removeFromSuperview];
+		cell.hidden = NO;
+		[self _enqueueReusableCell:cell];
+	}
+	[_prefetchedItems removeAllObjects];
+}
+
 - (BOOL)pullDownViewIsVisible
 {
 	if(_pullDownView) {
@@ -984,6 +1068,91 @@ static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
   
 }
 
+/**
+ * @internal
+ * @brief Work out how far the viewport can scroll before a full layout is needed
+ *
+ * Moving the viewport within this range doesn't bring any row, section,
+ * header, footer or pull down view into or out of view, so there's nothing
+ * to recycle and layoutSubviews can skip straight past the cells.
+ */
+- (void)_updateLayoutRange
+{
+	_tableFlags.layoutRangeValid = 0;
+
+	NSArray *visibleIndexPaths = [INDEX_PATHS_FOR_VISIBLE_ROWS sortedArrayUsingSelector:@selector(compare:)];
+	if([visibleIndexPaths count] == 0 || _dragToReorderCell != nil)
+		return;
+
+	CGRect visible = [self visibleRect];
+	CGFloat minY = CGRectGetMinY(visible);
+	CGFloat maxY = CGRectGetMaxY(visible);
+
+	// the range of vertical offsets (relative to now) the viewport can move by
+	__block CGFloat minDelta = -CGFLOAT_MAX;
+	__block CGFloat maxDelta = CGFLOAT_MAX;
+
+	// keep a rect's visibility the same as it is now
+	void (^constrain)(CGRect) = ^(CGRect r) {
+		if(CGRectIsEmpty(r))
+			return;
+		if(CGRectGetMinY(r) >= maxY) {
+			maxDelta = MIN(maxDelta, CGRectGetMinY(r) - maxY);
+		} else if(CGRectGetMaxY(r) <= minY) {
+			minDelta = MAX(minDelta, CGRectGetMaxY(r) - minY);
+		} else {
+			minDelta = MAX(minDelta, CGRectGetMinY(r) - maxY);
+			maxDelta = MIN(maxDelta, CGRectGetMaxY(r) - minY);
+		}
+	};
+
+	// rows are contiguous, so it's enough to keep the top and bottom rows
+	// visible and their neighbours (which lie beyond their outer edges) out
+	NSIndexPath *topIndexPath = [visibleIndexPaths objectAtIndex:0];
+	NSIndexPath *bottomIndexPath = [visibleIndexPaths lastObject];
+	CGRect topRect = [self rectForRowAtIndexPath:topIndexPath];
+	CGRect bottomRect = [self rectForRowAtIndexPath:bottomIndexPath];
+	constrain(topRect);
+	constrain(bottomRect);
+	maxDelta = MIN(maxDelta, CGRectGetMaxY(topRect) - maxY);
+	minDelta = MAX(minDelta, CGRectGetMinY(bottomRect) - minY);
+
+	NSInteger firstSection = MAX(0, topIndexPath.section - 1);
+	NSInteger lastSection = MIN((NSInteger)[_sectionInfo count] - 1, bottomIndexPath.section + 1);
+	for(NSInteger section = firstSection; section <= lastSection; ++section) {
+		constrain([self rectForSection:section]);
+		constrain([self rectForHeaderOfSection:section]);
+	}
+
+	CGSize s = self.contentSize;
+	if(self.headerView)
+		constrain(CGRectMake(0, s.height - self.headerView.frame.size.height, visible.size.width, self.headerView.frame.size.height));
+	if(_pullDownView)
+		constrain(CGRectMake(0, s.height, visible.size.width, _pullDownView.frame.size.height));
+	if(self.footerView)
+		constrain(CGRectMake(0, 0, visible.size.width, self.footerView.frame.size.height));
+
+	if(minDelta < 0.0 && maxDelta > 0.0) {
+		_layoutRange.minimumY = minY + minDelta;
+		_layoutRange.maximumY = minY + maxDelta;
+		_layoutRange.x = visible.origin.x;
+		_layoutRange.width = visible.size.width;
+		_tableFlags.layoutRangeValid = 1;
+	}
+}
+
+- (BOOL)_visibleRectIsWithinLayoutRange
+{
+	if(!_tableFlags.layoutRangeValid || _dragToReorderCell != nil)
+		return NO;
+
+	CGRect visible = [self visibleRect];
+	return visible.origin.x == _layoutRange.x
+		&& visible.size.width == _layoutRange.width
+		&& visible.origin.y > _layoutRange.minimumY
+		&& visible.origin.y < _layoutRange.maximumY;
+}
+
 - (void)layoutSubviews
 {
 	if(!_tableFlags.layoutSubviewsReentrancyGuard) {
@@ -995,11 +1164,22 @@ static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
 			
 			BOOL visibleCellsNeedRelayout = [self _preLayoutCells];
 			[super layoutSubviews]; // this will munge with the contentOffset
-			[self _layoutSectionHeaders:visibleCellsNeedRelayout];
-			[self _layoutCells:visibleCellsNeedRelayout];
 			
-			if(_tableFlags.derepeaterEnabled)
-				[self _updateDerepeaterViews];
+			if(visibleCellsNeedRelayout || ![self _visibleRectIsWithinLayoutRange]) {
+				[self _layoutSectionHeaders:visibleCellsNeedRelayout];
+				[self _layoutCells:visibleCellsNeedRelayout];
+				[self _updateLayoutRange];
+
+				if(_tableFlags.derepeaterEnabled)
+					[self _updateDerepeaterViews];
+			} else {
+				// only the offset moved and nothing came into or out of view, but
+				// pinned headers and derepeater views track the edge of the viewport
+				if(_style == TUITableViewStyleGrouped)
+					[self _layoutSectionHeaders:NO];
+				if(_tableFlags.derepeaterEnabled)
+					[self _updateDerepeaterViews];
+			}
 			
 			[CATransaction commit];
 		}];
@@ -1018,6 +1198,7 @@ static NSInteger SortCells(TUITableViewCell *a, TUITableViewCell *b, void *ctx)
 	[super layoutSubviews]; // this will munge with the contentOffset
 	[self _layoutSectionHeaders:YES];
 	[self _layoutCells:YES];
+	[self _updateLayoutRange];
 }
 
 - (void)scrollToRowAtIndexPath:(NSIndexPath *)indexPath atScrollPosition:(TUITableViewScrollPosition)scrollPosition animated:(BOOL)animated
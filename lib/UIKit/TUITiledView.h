@@ -0,0 +1,79 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import "TUIView.h"
+
+// A TUITiledView draws its content as a grid of fixed-size tiles rather
+// than into one backing store the size of its bounds, so it can host very
+// large content, typically as the document view of a TUIScrollView.
+//
+// Only tiles intersecting the visible part of the view, plus a prefetch
+// margin, are drawn. Each tile is drawn on a background queue by calling
+// -drawRect: (or the drawRect block) with the tile's rect, so drawing code
+// must be safe to run off the main thread and concurrently for different
+// rects. Set drawQueue to control how many tiles draw at once; by default
+// tiles are drawn on the default priority global queue.
+//
+// -setNeedsDisplayInRect: only redraws the tiles the rect touches, and a
+// tile keeps showing its old content until the new content is ready.
+// Tiles that scroll out of view stay cached while the view's tile bitmaps
+// fit in tileMemoryBudget; past that, the least recently visible tiles are
+// discarded first.
+//
+// When the view is magnified by a transform on it or any ancestor (such as
+// a zooming TUIScrollView), tiles are drawn at the power-of-two level of
+// detail that is at least as sharp as the content is shown. Tiles of the
+// previous level stay up, stretched, while the new level draws and are
+// discarded once it covers the visible rect. Call -setNeedsLayout after
+// changing an ancestor's transform directly.
+@interface TUITiledView : TUIView
+
+// Size of a tile in points. Default 256x256.
+@property (nonatomic, assign) CGSize tileSize;
+
+// How far beyond the visible rect, in points, tiles are drawn ahead of
+// being scrolled into view. Default 256.
+@property (nonatomic, assign) CGFloat prefetchMargin;
+
+// Bytes of tile bitmaps to keep for tiles outside the visible rect and
+// prefetch margin. Tiles within them are never discarded. Default 32MB.
+@property (nonatomic, assign) NSUInteger tileMemoryBudget;
+
+// Bytes currently used by tile bitmaps.
+@property (nonatomic, readonly) NSUInteger tileMemoryUsage;
+
+// Levels of detail tiles may be drawn at: level n is drawn at 2^n times
+// the backing scale. Defaults 0 and 4 (up to 16x magnification); a
+// negative minimum draws cheaper tiles when the view is shrunk.
+@property (nonatomic, assign) NSInteger minimumLevelOfDetail;
+@property (nonatomic, assign) NSInteger maximumLevelOfDetail;
+
+// The level of detail of the most recent tiles.
+@property (nonatomic, readonly) NSInteger levelOfDetail;
+
+// How much the view is magnified on screen by its own and its ancestors'
+// transforms.
+@property (nonatomic, readonly) CGFloat effectiveZoomScale;
+
+// The part of the bounds not clipped away by the view's ancestors, or
+// CGRectNull if the view is not in a window.
+@property (nonatomic, readonly) CGRect visibleTileRect;
+
+// Discards every tile that is not currently visible or within the
+// prefetch margin.
+- (void)discardOffscreenTiles;
+
+@end
@@ -0,0 +1,515 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import "TUITiledView.h"
+#import "TUIBackingStorePool.h"
+#import "TUICGAdditions.h"
+#import "TUIView+Private.h"
+
+@interface TUITiledViewTile : NSObject
+
+@property (nonatomic, strong) NSNumber *key;
+@property (nonatomic, strong) CALayer *layer;
+@property (nonatomic, assign) CGRect rect;
+@property (nonatomic, assign) NSInteger level;
+@property (nonatomic, assign) CGFloat scale;
+@property (nonatomic, assign) NSUInteger byteCount;
+@property (nonatomic, assign) NSUInteger lastVisiblePass;
+
+// bumped on every invalidation, so a render that finishes after the tile
+// was invalidated again knows its result is already stale
+@property (nonatomic, assign) NSUInteger generation;
+@property (nonatomic, assign) BOOL needsDisplay;
+@property (nonatomic, assign) BOOL rendering;
+
+@end
+
+@implementation TUITiledViewTile
+
+@synthesize key;
+@synthesize layer;
+@synthesize rect;
+@synthesize level;
+@synthesize scale;
+@synthesize byteCount;
+@synthesize lastVisiblePass;
+@synthesize generation;
+@synthesize needsDisplay;
+@synthesize rendering;
+
+@end
+
+@interface TUITiledView () {
+	NSMutableDictionary *_tiles;
+	NSMutableDictionary *_levelContainers;
+	CALayer *_tileContainer;
+
+	CGRect _tiledBounds;
+	CGFloat _tiledScale;
+	CGRect _lastVisibleTileRect;
+	NSInteger _levelOfDetail;
+	NSUInteger _pass;
+
+	struct {
+		unsigned int tilesNeedUpdate:1;
+	} _tiledViewFlags;
+}
+
+- (void)_updateTiles;
+- (void)_renderTile:(TUITiledViewTile *)tile;
+
+@end
+
+@implementation TUITiledView
+
+@synthesize tileSize = _tileSize;
+@synthesize prefetchMargin = _prefetchMargin;
+@synthesize tileMemoryBudget = _tileMemoryBudget;
+@synthesize minimumLevelOfDetail = _minimumLevelOfDetail;
+@synthesize maximumLevelOfDetail = _maximumLevelOfDetail;
+@synthesize levelOfDetail = _levelOfDetail;
+
+- (id)initWithFrame:(CGRect)frame
+{
+	if ((self = [super initWithFrame:frame])) {
+		_tileSize = CGSizeMake(256, 256);
+		_prefetchMargin = 256;
+		_tileMemoryBudget = 32 * 1024 * 1024;
+		_maximumLevelOfDetail = 4;
+		_tiles = [[NSMutableDictionary alloc] init];
+		_levelContainers = [[NSMutableDictionary alloc] init];
+		_lastVisibleTileRect = CGRectNull;
+
+		_tileContainer = [CALayer layer];
+		_tileContainer.anchorPoint = CGPointZero;
+		_tileContainer.actions = [NSDictionary dictionaryWithObjectsAndKeys:
+								  [NSNull null], @"position",
+								  [NSNull null], @"bounds",
+								  [NSNull null], @"sublayers",
+								  nil];
+		[self.layer insertSublayer:_tileContainer atIndex:0];
+	}
+	return self;
+}
+
+// the view's own layer never gets a backing store; everything is drawn into tiles
+- (BOOL)_disableDrawRect
+{
+	return YES;
+}
+
+- (void)setTileSize:(CGSize)size
+{
+	if (CGSizeEqualToSize(size, _tileSize))
+		return;
+
+	_tileSize = CGSizeMake(MAX(16, roundf(size.width)), MAX(16, roundf(size.height)));
+	[self _discardAllTiles];
+	[self setNeedsLayout];
+}
+
+- (void)setPrefetchMargin:(CGFloat)margin
+{
+	_prefetchMargin = MAX(0, margin);
+	_tiledViewFlags.tilesNeedUpdate = 1;
+	[self setNeedsLayout];
+}
+
+- (void)setTileMemoryBudget:(NSUInteger)budget
+{
+	_tileMemoryBudget = budget;
+	_tiledViewFlags.tilesNeedUpdate = 1;
+	[self setNeedsLayout];
+}
+
+- (void)setMinimumLevelOfDetail:(NSInteger)level
+{
+	_minimumLevelOfDetail = MAX(-8, MIN(level, 0));
+	_tiledViewFlags.tilesNeedUpdate = 1;
+	[self setNeedsLayout];
+}
+
+- (void)setMaximumLevelOfDetail:(NSInteger)level
+{
+	_maximumLevelOfDetail = MAX(0, MIN(level, 15));
+	_tiledViewFlags.tilesNeedUpdate = 1;
+	[self setNeedsLayout];
+}
+
+- (CGFloat)effectiveZoomScale
+{
+	CGRect unit = [self.layer convertRect:CGRectMake(0, 0, 1, 1) toLayer:nil];
+	return MAX(fabs(unit.size.width), fabs(unit.size.height));
+}
+
+- (NSUInteger)tileMemoryUsage
+{
+	NSUInteger usage = 0;
+	for (TUITiledViewTile *tile in [_tiles objectEnumerator])
+		usage += tile.byteCount;
+	return usage;
+}
+
+- (CGRect)visibleTileRect
+{
+	if (self.nsWindow == nil)
+		return CGRectNull;
+
+	CGRect visible = self.bounds;
+	for (TUIView *ancestor = self.superview; ancestor != nil && !CGRectIsEmpty(visible); ancestor = ancestor.superview)
+		visible = CGRectIntersection(visible, [self convertRect:ancestor.bounds fromView:ancestor]);
+
+	return CGRectIsEmpty(visible) ? CGRectNull : visible;
+}
+
+- (void)setNeedsDisplay
+{
+	for (TUITiledViewTile *tile in [_tiles objectEnumerator]) {
+		tile.generation++;
+		tile.needsDisplay = YES;
+	}
+	_tiledViewFlags.tilesNeedUpdate = 1;
+	[self setNeedsLayout];
+}
+
+- (void)setNeedsDisplayInRect:(CGRect)rect
+{
+	for (TUITiledViewTile *tile in [_tiles objectEnumerator]) {
+		if (CGRectIntersectsRect(tile.rect, rect)) {
+			tile.generation++;
+			tile.needsDisplay = YES;
+		}
+	}
+	_tiledViewFlags.tilesNeedUpdate = 1;
+	[self setNeedsLayout];
+}
+
+- (void)didAddSubview:(TUIView *)subview
+{
+	[super didAddSubview:subview];
+
+	// subviews inserted at index 0 would otherwise end up under the tiles
+	if ([self.layer.sublayers objectAtIndex:0] != _tileContainer) {
+		[_tileContainer removeFromSuperlayer];
+		[self.layer insertSublayer:_tileContainer atIndex:0];
+	}
+}
+
+- (void)layoutSubviews
+{
+	[super layoutSubviews];
+	[self _updateTiles];
+}
+
+- (void)ancestorDidLayout
+{
+	[super ancestorDidLayout];
+	[self _updateTiles];
+}
+
+- (void)discardOffscreenTiles
+{
+	NSUInteger budget = _tileMemoryBudget;
+	_tileMemoryBudget = 0;
+	_tiledViewFlags.tilesNeedUpdate = 1;
+	[self _updateTiles];
+	_tileMemoryBudget = budget;
+}
+
+/**
+ * @internal
+ * @brief Throw away every tile, e.g. because the tile grid no longer lines up
+ */
+- (void)_discardAllTiles
+{
+	[CATransaction begin];
+	[CATransaction setDisableActions:YES];
+	for (CALayer *container in [_levelContainers objectEnumerator])
+		[container removeFromSuperlayer];
+	[CATransaction commit];
+
+	[_tiles removeAllObjects];
+	[_levelContainers removeAllObjects];
+	_tiledViewFlags.tilesNeedUpdate = 1;
+}
+
+/**
+ * @internal
+ * @brief Throw away the tiles of every level of detail but one
+ *
+ * Called once the current level covers the visible rect, so the coarser or
+ * sharper tiles that were standing in for it are no longer seen.
+ */
+- (void)_discardLevelsOtherThan:(NSInteger)level
+{
+	for (TUITiledViewTile *tile in [_tiles allValues]) {
+		if (tile.level != level)
+			[_tiles removeObjectForKey:tile.key];
+	}
+
+	for (NSNumber *key in [_levelContainers allKeys]) {
+		if ([key integerValue] != level) {
+			[[_levelContainers objectForKey:key] removeFromSuperlayer];
+			[_levelContainers removeObjectForKey:key];
+		}
+	}
+}
+
+/**
+ * @internal
+ * @brief The layer holding the tiles of a level of detail
+ *
+ * Sharper levels sit above coarser ones, so whatever the current level has
+ * already drawn covers the stretched tiles standing in for the rest.
+ */
+- (CALayer *)_containerForLevel:(NSInteger)level
+{
+	NSNumber *key = [NSNumber numberWithInteger:level];
+	CALayer *container = [_levelContainers objectForKey:key];
+	if (!container) {
+		container = [CALayer layer];
+		container.anchorPoint = CGPointZero;
+		container.frame = _tileContainer.bounds;
+		container.zPosition = level;
+		[_tileContainer addSublayer:container];
+		[_levelContainers setObject:container forKey:key];
+	}
+	return container;
+}
+
+/**
+ * @internal
+ * @brief Bring the set of tiles in line with the visible rect
+ *
+ * Creates and draws tiles that are visible or within the prefetch margin,
+ * nearest the middle of the visible rect first, then discards the least
+ * recently visible offscreen tiles until their bitmaps fit in the budget.
+ * Does nothing if neither the visible rect nor any tile has changed since
+ * the last pass.
+ */
+- (void)_updateTiles
+{
+	CGRect b = self.bounds;
+	CGFloat scale = [self.layer respondsToSelector:@selector(contentsScale)] ? self.layer.contentsScale : 1.0f;
+
+	if (!CGRectEqualToRect(b, _tiledBounds) || scale != _tiledScale) {
+		[self _discardAllTiles];
+		_tiledBounds = b;
+		_tiledScale = scale;
+		_tileContainer.bounds = CGRectMake(0, 0, b.size.width, b.size.height);
+		_tileContainer.position = b.origin;
+	}
+
+	CGRect visible = self.visibleTileRect;
+
+	// draw at the smallest power of two at least as sharp as the content is shown
+	CGFloat zoomScale = self.effectiveZoomScale;
+	NSInteger level = (zoomScale > 0.0) ? (NSInteger)ceil(log2(zoomScale) - 0.01) : 0;
+	level = MAX(_minimumLevelOfDetail, MIN(level, _maximumLevelOfDetail));
+
+	if (!_tiledViewFlags.tilesNeedUpdate && level == _levelOfDetail && CGRectEqualToRect(visible, _lastVisibleTileRect))
+		return;
+
+	_tiledViewFlags.tilesNeedUpdate = 0;
+	_lastVisibleTileRect = visible;
+	_levelOfDetail = level;
+	_pass++;
+
+	CGFloat levelScale = pow(2.0, level);
+	CGSize levelTileSize = CGSizeMake(_tileSize.width / levelScale, _tileSize.height / levelScale);
+	BOOL levelCoversVisibleRect = YES;
+
+	NSMutableArray *toRender = [NSMutableArray array];
+
+	[CATransaction begin];
+	[CATransaction setDisableActions:YES];
+
+	if (!CGRectIsNull(visible)) {
+		// the margin is in screen points, so it shrinks as the content is magnified
+		CGFloat margin = _prefetchMargin / MAX(zoomScale, 0.01);
+		CGRect wanted = CGRectIntersection(CGRectInset(visible, -margin, -margin), b);
+		CALayer *container = [self _containerForLevel:level];
+
+		// tile coordinates are relative to the bounds origin
+		NSInteger firstColumn = floor((CGRectGetMinX(wanted) - b.origin.x) / levelTileSize.width);
+		NSInteger lastColumn = ceil((CGRectGetMaxX(wanted) - b.origin.x) / levelTileSize.width) - 1;
+		NSInteger firstRow = floor((CGRectGetMinY(wanted) - b.origin.y) / levelTileSize.height);
+		NSInteger lastRow = ceil((CGRectGetMaxY(wanted) - b.origin.y) / levelTileSize.height) - 1;
+
+		for (NSInteger row = MAX(0, firstRow); row <= lastRow; row++) {
+			for (NSInteger column = MAX(0, firstColumn); column <= lastColumn; column++) {
+				unsigned long long packed = ((unsigned long long)(level + 32) << 48) | ((unsigned long long)row << 24) | (unsigned long long)column;
+				NSNumber *key = [NSNumber numberWithUnsignedLongLong:packed];
+				TUITiledViewTile *tile = [_tiles objectForKey:key];
+
+				if (!tile) {
+					CGRect tileRect = CGRectMake(column * levelTileSize.width, row * levelTileSize.height, levelTileSize.width, levelTileSize.height);
+					tileRect = CGRectIntersection(tileRect, CGRectMake(0, 0, b.size.width, b.size.height));
+
+					tile = [[TUITiledViewTile alloc] init];
+					tile.key = key;
+					tile.rect = CGRectOffset(tileRect, b.origin.x, b.origin.y);
+					tile.level = level;
+					tile.scale = scale * levelScale;
+					tile.needsDisplay = YES;
+					tile.layer = [CALayer layer];
+					tile.layer.anchorPoint = CGPointZero;
+					tile.layer.frame = tileRect;
+					tile.layer.opaque = self.opaque;
+					if ([tile.layer respondsToSelector:@selector(setContentsScale:)])
+						tile.layer.contentsScale = tile.scale;
+					[container addSublayer:tile.layer];
+					[_tiles setObject:tile forKey:key];
+				}
+
+				tile.lastVisiblePass = _pass;
+				if (tile.needsDisplay && !tile.rendering)
+					[toRender addObject:tile];
+				if (tile.layer.contents == nil && CGRectIntersectsRect(tile.rect, visible))
+					levelCoversVisibleRect = NO;
+			}
+		}
+	}
+
+	if (levelCoversVisibleRect && [_levelContainers count] > 1)
+		[self _discardLevelsOtherThan:level];
+
+	// evict offscreen tiles, least recently visible first
+	NSMutableArray *offscreen = [NSMutableArray array];
+	NSUInteger offscreenBytes = 0;
+	for (TUITiledViewTile *tile in [_tiles objectEnumerator]) {
+		if (tile.lastVisiblePass != _pass) {
+			[offscreen addObject:tile];
+			offscreenBytes += tile.byteCount;
+		}
+	}
+
+	if (offscreenBytes > _tileMemoryBudget) {
+		[offscreen sortUsingComparator:^NSComparisonResult(TUITiledViewTile *a, TUITiledViewTile *z) {
+			if (a.lastVisiblePass == z.lastVisiblePass) return NSOrderedSame;
+			return (a.lastVisiblePass < z.lastVisiblePass) ? NSOrderedAscending : NSOrderedDescending;
+		}];
+
+		for (TUITiledViewTile *tile in offscreen) {
+			if (offscreenBytes <= _tileMemoryBudget)
+				break;
+
+			offscreenBytes -= tile.byteCount;
+			[tile.layer removeFromSuperlayer];
+			[_tiles removeObjectForKey:tile.key];
+		}
+	}
+
+	[CATransaction commit];
+
+	CGPoint middle = CGPointMake(CGRectGetMidX(visible), CGRectGetMidY(visible));
+	[toRender sortUsingComparator:^NSComparisonResult(TUITiledViewTile *a, TUITiledViewTile *z) {
+		CGFloat da = hypot(CGRectGetMidX(a.rect) - middle.x, CGRectGetMidY(a.rect) - middle.y);
+		CGFloat dz = hypot(CGRectGetMidX(z.rect) - middle.x, CGRectGetMidY(z.rect) - middle.y);
+		if (da == dz) return NSOrderedSame;
+		return (da < dz) ? NSOrderedAscending : NSOrderedDescending;
+	}];
+
+	for (TUITiledViewTile *tile in toRender)
+		[self _renderTile:tile];
+}
+
+/**
+ * @internal
+ * @brief Draw a tile on a background queue and install the result
+ */
+- (void)_renderTile:(TUITiledViewTile *)tile
+{
+	typedef void (*DrawRectIMP)(id,SEL,CGRect);
+	SEL drawRectSEL = @selector(drawRect:);
+	DrawRectIMP drawRectIMP = (DrawRectIMP)[self methodForSelector:drawRectSEL];
+	TUIViewDrawRect drawRectBlock = self.drawRect;
+
+	CGRect rect = tile.rect;
+	CGFloat scale = tile.scale;
+	BOOL opaque = self.opaque;
+	BOOL clears = self.clearsContextBeforeDrawing;
+	BOOL smoothFonts = self.subpixelTextRenderingEnabled;
+	NSUInteger generation = tile.generation;
+
+	tile.rendering = YES;
+
+	void (^drawBlock)(void) = ^{
+		CGSize pixelSize = CGSizeMake(MAX(1, ceil(rect.size.width * scale)), MAX(1, ceil(rect.size.height * scale)));
+		CGContextRef context = TUICreateGraphicsContextWithOptions(pixelSize, opaque);
+		TUIGraphicsPushContext(context);
+
+		TUISetCurrentContextScaleFactor(scale);
+		CGContextScaleCTM(context, scale, scale);
+		CGContextTranslateCTM(context, -rect.origin.x, -rect.origin.y);
+		CGContextClipToRect(context, rect);
+
+		if (clears)
+			CGContextClearRect(context, rect);
+
+		CGContextSetAllowsAntialiasing(context, true);
+		CGContextSetShouldAntialias(context, true);
+		CGContextSetShouldSmoothFonts(context, smoothFonts);
+
+		if (drawRectBlock)
+			drawRectBlock(self, rect);
+		else
+			drawRectIMP(self, drawRectSEL, rect);
+
+		NSUInteger byteCount = CGBitmapContextGetBytesPerRow(context) * CGBitmapContextGetHeight(context);
+		TUIGraphicsPopContext();
+		CGImageRef image = [[TUIBackingStorePool sharedPool] createImageByDetachingContext:context];
+
+		dispatch_async(dispatch_get_main_queue(), ^{
+			tile.rendering = NO;
+
+			// evicted or discarded while drawing
+			if ([_tiles objectForKey:tile.key] != tile) {
+				CGImageRelease(image);
+				return;
+			}
+
+			[CATransaction begin];
+			[CATransaction setDisableActions:YES];
+			tile.layer.contents = (__bridge id)image;
+			[CATransaction commit];
+			CGImageRelease(image);
+
+			tile.byteCount = byteCount;
+
+			// even if it's stale the new image is closer than what was there,
+			// but the tile still needs another pass
+			if (tile.generation == generation)
+				tile.needsDisplay = NO;
+			else
+				_tiledViewFlags.tilesNeedUpdate = 1;
+
+			// the levels standing in for this one may be discardable now
+			if ([_levelContainers count] > 1)
+				_tiledViewFlags.tilesNeedUpdate = 1;
+
+			[self _updateTiles];
+		});
+	};
+
+	if (self.drawQueue != nil) {
+		[self.drawQueue addOperationWithBlock:drawBlock];
+	} else {
+		dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), drawBlock);
+	}
+}
+
+@end
@@ -7,6 +7,7 @@
 //
 
 #import "TUIView+Accessibility.h"
+#import "TUIView+Private.h"
 
 
 @implementation TUIView (Accessibility)
@@ -98,7 +99,7 @@
 			return textRenderer;
 		}
 		
-		NSArray *s = [self sortedSubviews];
+		NSArray *s = [self _sortedSubviewsAtPoint:point];
 		for(TUIView *v in [s reverseObjectEnumerator]) {
 			TUIView *hit = [v accessibilityHitTest:[self convertPoint:point toView:v]];
 			if(hit)
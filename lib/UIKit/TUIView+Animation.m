@@ -239,6 +239,9 @@ static CGFloat TUIViewAnimationSlowMotionMultiplier (void) {
 	TUIViewAnimation *animation = TUIViewCurrentAnimation;
 	if (animation == nil) return defaultAction;
 
+	// a flattened image can't show the animation
+	[self _subtreeDidChange];
+
 	if ([TUICAAction interceptsActionForKey:event]) {
 		return [TUICAAction actionWithAction:animation];
 	} else {
@@ -15,8 +15,8 @@
  */
 
 #import "TUIView+PasteboardDragging.h"
-#import "TUICGAdditions.h"
 #import "TUINSView.h"
+#import "TUIView+Snapshot.h"
 
 @implementation TUIView (PasteboardDragging)
 
@@ -63,9 +63,8 @@
 		TUIView *dragView = [self handleForPasteboardDragView];
 		id<NSPasteboardWriting> pasteboardObject = [dragView representedPasteboardObject];
 		
-		NSImage *dragNSImage = TUIGraphicsDrawAsImage(dragView.frame.size, ^{
-			[TUIGraphicsGetImageForView(dragView) drawAtPoint:CGPointZero fromRect:CGRectZero operation:NSCompositeSourceOver fraction:0.75];
-		});
+		// composited from what's already on screen, faded as it goes
+		NSImage *dragNSImage = [dragView snapshotWithAlpha:0.75];
 		
 		NSPasteboard *pasteboard = [NSPasteboard pasteboardWithName:NSDragPboard];
 		[pasteboard clearContents];
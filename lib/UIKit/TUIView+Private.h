@@ -27,7 +27,28 @@ typedef void (^TUIMouseDraggedHandler)(NSEvent *dragEvent);
 
 - (TUITextRenderer *)textRendererAtPoint:(CGPoint)point;
 - (void)_updateLayerScaleFactor;
+- (void)_restoreDiscardedContentsIfVisible;
+- (BOOL)_isVisible; // any of the view is on screen
+- (BOOL)_needsDisplay; // marked as needing display, whether it is queued in the display pass or its layer is
+- (BOOL)_disableDrawRect; // per class: YES if instances never draw into their own layer
+- (void)_subtreeDidChange; // undoes flattening by the view and its ancestors, see flattensStaticSubviews
+- (BOOL)_drawsOpaqueContent; // YES if -drawRect: is known to cover the bounds with opaque pixels
+- (void)_updateInferredOpacity; // call when what -_drawsOpaqueContent answers may have changed
+- (NSArray *)_sortedSubviewsAtPoint:(CGPoint)point; // back to front, may be a superset of those containing the point
+- (void)_finishPendingDraw; // draws on the main thread what a background draw hasn't delivered yet
+- (void)_subviewConstraintsDidChange; // call when constraints to "superview" were added to or removed from subviews
 
 @end
 
+@interface TUIView (SnapshotPrivate)
+
+- (void)_drawSnapshotInContext:(CGContextRef)context; // composites what the layer and its sublayers show, in the layer's coordinates, see TUIView+Snapshot.h
+
+@end
+
+// Changes whenever a view is added, removed, moved, resized, hidden or shown,
+// or made (non-)interactive, invalidating anything remembered about hit tests.
+extern NSUInteger TUIViewGetHitTestGeneration(void);
+
 extern CGFloat TUICurrentContextScaleFactor(void);
+extern void TUISetCurrentContextScaleFactor(CGFloat s);
@@ -0,0 +1,44 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import "TUIView.h"
+
+// Snapshots of a view and its subviews made from what their layers already
+// show, rather than by rendering the whole tree again with
+// -renderInContext:.
+//
+// Anything still waiting to display is displayed first, including draws
+// queued or running in the background, which are done again on the main
+// thread. Layers that draw through their contents image and a background
+// color are then composited straight from those; only layers using
+// features the compositor doesn't reproduce (masks, shadows, borders,
+// rounded corners, filters, 3D transforms, other layer classes, other
+// contents gravities) are rendered, and just their own subtrees.
+//
+// The alpha applies to the snapshot as a whole while it is composited, so
+// a translucent image costs no more than an opaque one.
+@interface TUIView (Snapshot)
+
+// Must be called on the main thread.
+- (NSImage *)snapshotWithAlpha:(CGFloat)alpha;
+
+// Collects the layer contents on the main thread, composites them on a
+// background queue and calls the completion back on the main thread. The
+// snapshot shows the view as it was when this was called.
+- (void)snapshotWithAlpha:(CGFloat)alpha completion:(void (^)(NSImage *snapshot))completion;
+
+@end
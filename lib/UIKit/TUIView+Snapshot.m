@@ -0,0 +1,270 @@
+/*
+ Copyright 2011 Twitter, Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this work except in compliance with the License.
+ You may obtain a copy of the License in the LICENSE file, or at:
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import "TUIView+Snapshot.h"
+#import "TUICGAdditions.h"
+
+// One layer's worth of drawing, collected on the main thread so the
+// composite can be made on any thread.
+@interface TUIViewSnapshotPart : NSObject
+
+// layer space -> snapshot space
+@property (nonatomic, assign) CGAffineTransform transform;
+@property (nonatomic, assign) CGRect bounds;
+@property (nonatomic, assign) CGFloat opacity;
+// CGPathRefs in snapshot space, from every ancestor that masks to bounds
+@property (nonatomic, strong) NSArray *clipPaths;
+@property (nonatomic, strong) id backgroundColor;
+@property (nonatomic, strong) id image;
+
+@end
+
+@implementation TUIViewSnapshotPart
+
+@synthesize transform;
+@synthesize bounds;
+@synthesize opacity;
+@synthesize clipPaths;
+@synthesize backgroundColor;
+@synthesize image;
+
+@end
+
+/**
+ * @internal
+ * @brief Whether the layer's own drawing is just its background color and contents image
+ */
+static BOOL TUIViewSnapshotCanComposite(CALayer *layer)
+{
+	if (![layer isMemberOfClass:[CALayer class]] || layer.geometryFlipped)
+		return NO;
+	if (layer.mask != nil || layer.shadowOpacity > 0.0 || layer.borderWidth > 0.0 || layer.cornerRadius > 0.0)
+		return NO;
+	if ([layer.filters count] > 0 || [layer.backgroundFilters count] > 0 || layer.compositingFilter != nil)
+		return NO;
+	if (!CATransform3DIsAffine(layer.transform) || !CATransform3DIsIdentity(layer.sublayerTransform))
+		return NO;
+
+	id contents = layer.contents;
+	if (contents == nil)
+		return YES;
+	if (CFGetTypeID((__bridge CFTypeRef)contents) != CGImageGetTypeID())
+		return NO;
+	return CGRectEqualToRect(layer.contentsRect, CGRectMake(0, 0, 1, 1)) && [layer.contentsGravity isEqualToString:kCAGravityResize];
+}
+
+/**
+ * @internal
+ * @brief Render a layer and its sublayers into an image of its bounds
+ */
+static id TUIViewSnapshotRenderLayer(CALayer *layer, CGFloat scale)
+{
+	CGRect b = layer.bounds;
+	CGContextRef context = TUICreateGraphicsContext(CGSizeMake(ceil(b.size.width * scale), ceil(b.size.height * scale)));
+	if (!context)
+		return nil;
+
+	CGContextScaleCTM(context, scale, scale);
+	CGContextTranslateCTM(context, -b.origin.x, -b.origin.y);
+	[layer renderInContext:context];
+
+	CGImageRef image = TUICreateCGImageFromBitmapContext(context);
+	CGContextRelease(context);
+	return CFBridgingRelease(image);
+}
+
+/**
+ * @internal
+ * @brief Collect the parts for a layer and its visible sublayers, back to front
+ */
+static void TUIViewSnapshotCollectParts(CALayer *layer, CGAffineTransform transform, CGFloat opacity, NSArray *clipPaths, CGFloat scale, NSMutableArray *parts)
+{
+	// display whatever is still missing, and only that. A view drawing in
+	// the background only queues its draw, which would arrive too late
+	id delegate = layer.delegate;
+	if ([delegate isKindOfClass:[TUIView class]]) {
+		[(TUIView *)delegate displayIfNeeded];
+		[(TUIView *)delegate _finishPendingDraw];
+	} else {
+		[layer displayIfNeeded];
+	}
+
+	TUIViewSnapshotPart *part = [[TUIViewSnapshotPart alloc] init];
+	part.transform = transform;
+	part.bounds = layer.bounds;
+	part.clipPaths = clipPaths;
+	[parts addObject:part];
+
+	if (!TUIViewSnapshotCanComposite(layer)) {
+		part.opacity = opacity;
+		part.image = TUIViewSnapshotRenderLayer(layer, scale);
+		return;
+	}
+
+	opacity *= layer.opacity;
+	part.opacity = opacity;
+	part.backgroundColor = (__bridge id)layer.backgroundColor;
+	part.image = layer.contents;
+
+	if (layer.masksToBounds) {
+		CGPathRef path = CGPathCreateWithRect(layer.bounds, &transform);
+		clipPaths = clipPaths ? [clipPaths arrayByAddingObject:(__bridge id)path] : [NSArray arrayWithObject:(__bridge id)path];
+		CGPathRelease(path);
+	}
+
+	NSArray *sublayers = [layer.sublayers sortedArrayWithOptions:NSSortStable usingComparator:(NSComparator)^NSComparisonResult(CALayer *a, CALayer *b) {
+		if (a.zPosition > b.zPosition)
+			return NSOrderedDescending;
+		else if (a.zPosition < b.zPosition)
+			return NSOrderedAscending;
+		return NSOrderedSame;
+	}];
+
+	for (CALayer *sublayer in sublayers) {
+		if (sublayer.hidden || sublayer.opacity <= 0.0)
+			continue;
+
+		CGRect sb = sublayer.bounds;
+		CGPoint anchor = sublayer.anchorPoint;
+		CGPoint position = sublayer.position;
+		CGAffineTransform t = CGAffineTransformMakeTranslation(-sb.size.width * anchor.x - sb.origin.x, -sb.size.height * anchor.y - sb.origin.y);
+		t = CGAffineTransformConcat(t, CATransform3DGetAffineTransform(sublayer.transform));
+		t = CGAffineTransformConcat(t, CGAffineTransformMakeTranslation(position.x, position.y));
+		t = CGAffineTransformConcat(t, transform);
+
+		TUIViewSnapshotCollectParts(sublayer, t, opacity, clipPaths, scale, parts);
+	}
+}
+
+/**
+ * @internal
+ * @brief Draw collected parts into a context, in the coordinates they were collected in; safe on any thread
+ */
+static void TUIViewSnapshotDrawParts(CGContextRef context, NSArray *parts)
+{
+	for (TUIViewSnapshotPart *part in parts) {
+		if (!part.backgroundColor && !part.image)
+			continue;
+
+		CGContextSaveGState(context);
+		for (id path in part.clipPaths) {
+			CGContextAddPath(context, (__bridge CGPathRef)path);
+			CGContextClip(context);
+		}
+		CGContextConcatCTM(context, part.transform);
+		CGContextSetAlpha(context, part.opacity);
+		if (part.backgroundColor) {
+			CGContextSetFillColorWithColor(context, (__bridge CGColorRef)part.backgroundColor);
+			CGContextFillRect(context, part.bounds);
+		}
+		if (part.image)
+			CGContextDrawImage(context, part.bounds, (__bridge CGImageRef)part.image);
+		CGContextRestoreGState(context);
+	}
+}
+
+/**
+ * @internal
+ * @brief Composite collected parts into an image; safe on any thread
+ */
+static NSImage *TUIViewSnapshotComposite(NSArray *parts, CGSize size, CGFloat scale, CGFloat alpha)
+{
+	CGContextRef context = TUICreateGraphicsContext(CGSizeMake(ceil(size.width * scale), ceil(size.height * scale)));
+	if (!context)
+		return nil;
+
+	CGContextScaleCTM(context, scale, scale);
+
+	// parts are drawn at their own opacity inside the transparency layer,
+	// and the alpha is applied once as it is composited
+	CGContextSetAlpha(context, alpha);
+	CGContextBeginTransparencyLayer(context, NULL);
+	TUIViewSnapshotDrawParts(context, parts);
+	CGContextEndTransparencyLayer(context);
+
+	CGImageRef image = TUICreateCGImageFromBitmapContext(context);
+	CGContextRelease(context);
+	if (!image)
+		return nil;
+
+	NSImage *snapshot = [[NSImage alloc] initWithCGImage:image size:size];
+	CGImageRelease(image);
+	return snapshot;
+}
+
+@implementation TUIView (Snapshot)
+
+/**
+ * @internal
+ * @brief Collect the parts of the receiver's snapshot, in its bounds' coordinates
+ */
+- (NSArray *)_snapshotPartsWithScale:(CGFloat)scale
+{
+	CGRect b = self.layer.bounds;
+	return [self _snapshotPartsWithTransform:CGAffineTransformMakeTranslation(-b.origin.x, -b.origin.y) scale:scale];
+}
+
+/**
+ * @internal
+ * @brief Collect the parts of the receiver's snapshot, with the receiver's layer coordinates mapped through the transform
+ */
+- (NSArray *)_snapshotPartsWithTransform:(CGAffineTransform)transform scale:(CGFloat)scale
+{
+	NSAssert([NSThread isMainThread], @"%@ must be snapshotted on the main thread", self);
+
+	NSMutableArray *parts = [NSMutableArray array];
+	TUIViewSnapshotCollectParts(self.layer, transform, 1.0, nil, scale, parts);
+	return parts;
+}
+
+/**
+ * @internal
+ * @brief The pixel scale of the receiver's backing
+ */
+- (CGFloat)_snapshotScale
+{
+	return [self.layer respondsToSelector:@selector(contentsScale)] ? self.layer.contentsScale : 1.0f;
+}
+
+- (void)_drawSnapshotInContext:(CGContextRef)context
+{
+	TUIViewSnapshotDrawParts(context, [self _snapshotPartsWithTransform:CGAffineTransformIdentity scale:[self _snapshotScale]]);
+}
+
+- (NSImage *)snapshotWithAlpha:(CGFloat)alpha
+{
+	CGFloat scale = [self _snapshotScale];
+	return TUIViewSnapshotComposite([self _snapshotPartsWithScale:scale], self.layer.bounds.size, scale, alpha);
+}
+
+- (void)snapshotWithAlpha:(CGFloat)alpha completion:(void (^)(NSImage *snapshot))completion
+{
+	NSParameterAssert(completion != nil);
+
+	CGFloat scale = [self _snapshotScale];
+	NSArray *parts = [self _snapshotPartsWithScale:scale];
+	CGSize size = self.layer.bounds.size;
+
+	dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), ^{
+		NSImage *snapshot = TUIViewSnapshotComposite(parts, size, scale, alpha);
+		dispatch_async(dispatch_get_main_queue(), ^{
+			completion(snapshot);
+		});
+	});
+}
+
+@end
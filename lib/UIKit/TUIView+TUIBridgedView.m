@@ -10,6 +10,7 @@
 //
 
 #import "TUIView+TUIBridgedView.h"
+#import "TUIView+Private.h"
 #import "TUINSView.h"
 #import "TUIBridgedScrollView.h"
 #import <objc/runtime.h>
@@ -138,6 +139,9 @@
 }
 
 - (void)ancestorDidLayout; {
+	[self _restoreDiscardedContentsIfVisible];
+	// whatever this view had pending is covered by forwarding now
+	_viewFlags.subviewsNeedAncestorLayout = 0;
 	[self.subviews makeObjectsPerformSelector:_cmd];
 }
 
@@ -16,11 +16,12 @@
 
 #import "TUIResponder.h"
 #import "TUIAccessibility.h"
+#import "TUIBackingStorePool.h"
 
 extern NSString * const TUIViewWillMoveToWindowNotification; // both notification's userInfo will contain the new window under the key TUIViewWindow
 extern NSString * const TUIViewDidMoveToWindowNotification;
 extern NSString * const TUIViewWindow;
-extern NSString * const TUIViewFrameDidChangeNotification;
+extern NSString * const TUIViewFrameDidChangeNotification; // only posted by views with postsFrameChangedNotifications set
 
 enum {
 	TUIViewAutoresizingNone                 = 0,
@@ -72,6 +73,15 @@ extern CGRect(^TUIViewCenteredLayout)(TUIView*);
 
 @protocol TUIViewDelegate;
 
+#define TUIViewMaximumDirtyRects 8
+
+// The parts of a view waiting to be redrawn. Past TUIViewMaximumDirtyRects
+// rects, the two that waste the least area when combined are merged.
+typedef struct {
+	CGRect rects[TUIViewMaximumDirtyRects];
+	NSUInteger count;
+} TUIViewDirtyRegion;
+
 /**
  Root view class
  */
@@ -100,9 +110,14 @@ extern CGRect(^TUIViewCenteredLayout)(TUIView*);
 		NSInteger lastWidth;
 		NSInteger lastHeight;
 		BOOL lastOpaque;
+		TUIBackingStoreFormat format;
+		TUIBackingStoreFormat lastFormat;
 		CGContextRef context;
-		CGRect dirtyRect;
+		TUIViewDirtyRegion dirtyRegion;
 		CGFloat lastContentsScale;
+		CGPDFDocumentRef displayList;
+		NSUInteger displayListGeneration;
+		CFAbsoluteTime lastVisibleTime;
 	} _context;
 	
 	struct {
@@ -118,6 +133,16 @@ extern CGRect(^TUIViewCenteredLayout)(TUIView*);
 		unsigned int clearsContextBeforeDrawing:1;
 		unsigned int drawInBackground:1;
 		unsigned int needsDisplayWhenWindowsKeyednessChanges:1;
+		unsigned int recordsDrawing:1;
+		unsigned int contentsDiscarded:1;
+		unsigned int postsFrameChangedNotifications:1;
+		unsigned int postsFrameChangesForSubviewConstraints:1;
+		unsigned int frameChangePending:1;
+		unsigned int subviewsNeedAncestorLayout:1;
+		unsigned int flattensStaticSubviews:1;
+		unsigned int subviewsFlattened:1;
+		unsigned int hiddenByFlattening:1;
+		unsigned int opaqueSetExplicitly:1;
 		
 		unsigned int delegateMouseEntered:1;
 		unsigned int delegateMouseExited:1;
@@ -131,6 +156,7 @@ extern CGRect(^TUIViewCenteredLayout)(TUIView*);
 	TUIAccessibilityTraits accessibilityTraits;
 	CGRect accessibilityFrame;
 	NSOperationQueue *drawQueue;
+	id<NSCopying> contentCacheKey;
 }
 
 /**
@@ -188,7 +214,7 @@ extern CGRect(^TUIViewCenteredLayout)(TUIView*);
 @property (nonatomic, assign) TUIViewContentMode contentMode;
 
 /**
- If YES, drawing will be done in a background queue. If `drawQueue` is nil, it will be performed in the DISPATCH_QUEUE_PRIORITY_DEFAULT global queue. Note that `-viewWillDisplayLayer:` will still be called on the main thread.
+ If YES, drawing will be done in a background queue. If `drawQueue` is nil, it is scheduled by the shared TUIDrawScheduler, which draws views on screen first and commits finished drawing once per frame. The layer keeps its previous contents until the new drawing is ready. Note that `-viewWillDisplayLayer:` will still be called on the main thread.
  
  Defaults to NO.
  */
@@ -201,6 +227,64 @@ extern CGRect(^TUIViewCenteredLayout)(TUIView*);
  */
 @property (nonatomic, retain) NSOperationQueue *drawQueue;
 
+/**
+ If YES, the first time the view draws, its `-drawRect:` output for the whole bounds is recorded into a display list. Later displays replay the list instead of calling `-drawRect:` again, so a new scale factor or a dirty rect costs a replay rather than a redraw. The list is thrown away by `-setNeedsDisplay`, `-setNeedsDisplayInRect:` and changes to the view's size, so only set this on views whose drawing depends on nothing else.
+
+ Defaults to NO.
+ */
+@property (nonatomic, assign) BOOL recordsDrawing;
+
+/**
+ The pixel format of the view's backing store. A smaller format saves memory for views that draw only gray (separators) or only coverage (masks); see TUIBackingStoreFormat for what each can show. RGB16 and Gray8 only apply to opaque views, others get the default.
+
+ Defaults to TUIBackingStoreFormatARGB32.
+ */
+@property (nonatomic, assign) TUIBackingStoreFormat backingStoreFormat;
+
+/**
+ Identifies what the view draws. Views with the same key draw the same thing, so once one of them has drawn at a given size, scale and opacity, the others (or the same view, after being reused for content it showed before) display the cached image without calling `-drawRect:`. The key must change whenever the drawing would; `-setNeedsDisplay` alone does not bypass the cache. Keys must implement `-isEqual:` and `-hash`.
+
+ Defaults to nil, which never uses the cache.
+ */
+@property (nonatomic, copy) id<NSCopying> contentCacheKey;
+
+/**
+ Bytes of images the content cache shared by every view may hold on to. Default 16MB.
+ */
++ (NSUInteger)contentCacheByteLimit;
++ (void)setContentCacheByteLimit:(NSUInteger)limit;
+
+/**
+ Empties the content cache.
+ */
++ (void)removeAllCachedContent;
+
+/**
+ Views that have drawn but then stay out of sight (hidden, scrolled out of view, in a hidden or minimized window) for this long have their contents discarded, and draw again once they are back in sight. 0 disables this. Default is 30 seconds.
+ */
++ (NSTimeInterval)contentsDiscardInterval;
++ (void)setContentsDiscardInterval:(NSTimeInterval)interval;
+
+/**
+ Releases the drawn contents of the view and its subviews. They are drawn again when the view is next in sight. TUITableView calls this on cells it puts in its reuse queue.
+ */
+- (void)discardContents;
+
+/**
+ If YES, once the view's subviews have gone +framesBeforeFlattening display frames without changing, the view draws them on top of its own contents and leaves their layers out of the render tree, so Core Animation composites one layer instead of many. Any change to what the view shows puts the layers back: its own content or a subview's needing display, a resize or scroll of the view, a subview's geometry, alpha or hidden changes, an animation, or subviews being added or removed. Moving the view itself keeps them flattened. Subviews that aren't fully opaque in alpha, have a mask or a 3D transform, or host AppKit views are never flattened.
+
+ Flattened subviews still report themselves as not hidden and still take hit tests and events. Only set this on views whose subviews are otherwise left alone, like the icons and labels of a cell or toolbar; every change costs a fresh flatten later.
+
+ Defaults to NO.
+ */
+@property (nonatomic, assign) BOOL flattensStaticSubviews;
+
+/**
+ How many display frames subviews must go unchanged before a view with flattensStaticSubviews flattens them. Default is 30.
+ */
++ (NSUInteger)framesBeforeFlattening;
++ (void)setFramesBeforeFlattening:(NSUInteger)frames;
+
 /**
  Make this view the first responder. Returns NO if it fails.
  */
@@ -246,6 +330,11 @@ extern CGRect(^TUIViewCenteredLayout)(TUIView*);
  */
 @property (nonatomic, assign) CGAffineTransform transform;
 
+/**
+ Position in front of (higher) or behind (lower) the view's siblings. Default is 0. Set it here rather than on the layer so the superview's subview order, which hit testing uses, picks the change up.
+ */
+@property (nonatomic, assign) CGFloat zPosition;
+
 /**
  Recursively calls -pointInside:withEvent:. point is in frame coordinates (event ignored)
  */
@@ -272,8 +361,25 @@ extern CGRect(^TUIViewCenteredLayout)(TUIView*);
 - (CGSize)sizeThatFits:(CGSize)size;
 - (void)sizeToFit;                       // calls sizeThatFits: with current view bounds and changes bounds size.
 
+/**
+ Subviews in back to front order: by layer zPosition, then by order in `subviews`. The order is kept up to date as subviews are added and removed rather than sorted on every call.
+ */
 - (NSArray *)sortedSubviews;
 
+/**
+ If YES, hit testing looks up the subviews under a point in a grid over their frames instead of trying every subview, which helps views with hundreds of subviews. Subviews must then only take hits within their frames and be moved through the view geometry setters (not the layer's).
+
+ Defaults to NO.
+ */
+@property (nonatomic, assign) BOOL indexesSubviewsForHitTesting;
+
+/**
+ If YES, setting the frame posts TUIViewFrameDidChangeNotification. The notification is coalesced: it is posted once per view, at the end of the run loop turn in which the frame changed (before the turn's animations are committed), however many times the frame was set.
+
+ Defaults to NO. Views that take part in layout constraints, as a constrained view or a named source, turn this on automatically. A view with subviews constrained to "superview" posts while those constraints exist, whatever this is set to.
+ */
+@property (nonatomic, assign) BOOL postsFrameChangedNotifications;
+
 @end
 
 @interface TUIView (TUIViewHierarchy)
@@ -354,11 +460,25 @@ extern CGRect(^TUIViewCenteredLayout)(TUIView*);
 - (void)drawRect:(CGRect)rect;
 
 /**
- Marks the view as needing display, will happen before the next run loop cycle
+ Whether a class overrides -drawRect:, and the implementation to call, is looked up the first time one of its instances displays and remembered from then on. Call this after exchanging or replacing -drawRect: implementations at runtime (loading a bundle does this automatically).
+ */
++ (void)drawRectImplementationsDidChange;
+
+/**
+ Marks the view as needing display, will happen before the next run loop cycle, in the display pass (see TUIDisplayPass)
  */
 - (void)setNeedsDisplay;
+
+/**
+ Marks part of the view as needing display. Rects marked before the next display accumulate; only they are redrawn, on top of the view's previous contents, with drawing clipped to them. -drawRect: is called once with their union.
+ */
 - (void)setNeedsDisplayInRect:(CGRect)rect;
 
+/**
+ Displays the view right away if it is marked as needing display, rather than waiting for the display pass
+ */
+- (void)displayIfNeeded;
+
 /**
  Recursive -setNeedsDisplay
  */
@@ -370,7 +490,7 @@ extern CGRect(^TUIViewCenteredLayout)(TUIView*);
 @property (nonatomic) BOOL clipsToBounds;
 
 /**
- default is nil.  Setting this with a color with <1.0 alpha will also set opaque=NO
+ default is nil.  Setting this with a color with <1.0 alpha will also set opaque=NO, and with a fully opaque color, opaque=YES unless opaque was set explicitly
  */
 @property (nonatomic,copy) NSColor *backgroundColor;
 
@@ -381,9 +501,16 @@ extern CGRect(^TUIViewCenteredLayout)(TUIView*);
 
 /**
  default is YES. opaque views must fill their entire bounds or the results are undefined. the active CGContext in drawRect: will not have been cleared and may have non-zeroed pixels
+ Until it is set, it follows what the view is known to draw: YES with a fully opaque backgroundColor or content that covers the bounds opaquely (an opaque image in a TUIImageView), NO with a translucent backgroundColor.
  */
 @property (nonatomic,getter=isOpaque) BOOL opaque;
 
+/**
+ If YES, views that are blended although they could be opaque are logged, once per class: views that draw only opaque pixels into a non-opaque backing store, and views set not opaque whose background or content is opaque. Also turned on by the TUIReportAvoidableBlending environment variable. Default is NO.
+ */
++ (BOOL)reportsAvoidableBlending;
++ (void)setReportsAvoidableBlending:(BOOL)reports;
+
 /**
  default is NO. doesn't check superviews
  */
@@ -14,11 +14,20 @@
  limitations under the License.
  */
 
+#import <libkern/OSAtomic.h>
+#import <objc/runtime.h>
 #import <pthread.h>
 #import "NSColor+TUIExtensions.h"
+#import "TUIBackingStorePool.h"
 #import "TUICGAdditions.h"
+#import "TUIDisplayPass.h"
+#import "TUIDrawScheduler.h"
+#import "TUIFrameClock.h"
+#import "TUIHostView.h"
 #import "TUIView.h"
+#import "TUILayoutConstraint.h"
 #import "TUILayoutManager.h"
+#import "TUISubviewIndex.h"
 #import "TUINSView.h"
 #import "TUINSView+Private.h"
 #import "TUINSWindow.h"
@@ -69,7 +78,296 @@ CGRect(^TUIViewCenteredLayout)(TUIView*) = nil;
 @end
 
 
-@interface TUIView ()
+// identifies a rendering of some content in the content cache
+@interface TUIViewContentCacheKey : NSObject <NSCopying> {
+	id<NSCopying> _contentKey;
+	CGSize _size;
+	CGFloat _scale;
+	BOOL _opaque;
+}
+
+- (id)initWithContentKey:(id<NSCopying>)contentKey size:(CGSize)size scale:(CGFloat)scale opaque:(BOOL)opaque;
+
+@end
+
+@implementation TUIViewContentCacheKey
+
+- (id)initWithContentKey:(id<NSCopying>)contentKey size:(CGSize)size scale:(CGFloat)scale opaque:(BOOL)opaque
+{
+	if((self = [super init])) {
+		_contentKey = contentKey;
+		_size = size;
+		_scale = scale;
+		_opaque = opaque;
+	}
+	return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone
+{
+	return self;
+}
+
+- (NSUInteger)hash
+{
+	return [(id)_contentKey hash] ^ ((NSUInteger)_size.width << 16) ^ (NSUInteger)_size.height ^ ((NSUInteger)_scale << 28) ^ _opaque;
+}
+
+- (BOOL)isEqual:(id)object
+{
+	if(![object isKindOfClass:[TUIViewContentCacheKey class]])
+		return NO;
+	TUIViewContentCacheKey *other = object;
+	return CGSizeEqualToSize(_size, other->_size) && _scale == other->_scale && _opaque == other->_opaque && [(id)_contentKey isEqual:other->_contentKey];
+}
+
+@end
+
+static NSCache *TUIViewContentCache(void)
+{
+	static NSCache *cache = nil;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		cache = [[NSCache alloc] init];
+		cache.totalCostLimit = 16 * 1024 * 1024;
+	});
+	return cache;
+}
+
+typedef void (*TUIViewDrawRectIMP)(id,SEL,CGRect);
+
+// class -> its -drawRect: if it draws anything, NULL if not
+static CFMutableDictionaryRef TUIViewDrawRectIMPs = NULL;
+static OSSpinLock TUIViewDrawRectIMPsLock = OS_SPINLOCK_INIT;
+
+static TUIViewDrawRectIMP TUIViewGetDrawRectIMP(TUIView *view)
+{
+	Class cls = object_getClass(view);
+	const void *imp = NULL;
+
+	OSSpinLockLock(&TUIViewDrawRectIMPsLock);
+	BOOL cached = (TUIViewDrawRectIMPs != NULL) && CFDictionaryGetValueIfPresent(TUIViewDrawRectIMPs, (__bridge const void *)cls, &imp);
+	OSSpinLockUnlock(&TUIViewDrawRectIMPsLock);
+	if(cached)
+		return (TUIViewDrawRectIMP)imp;
+
+	// drawRect isn't overridden by the subclass, or the subclass never
+	// draws into its own layer
+	SEL drawRectSEL = @selector(drawRect:);
+	IMP drawRectIMP = class_getMethodImplementation(cls, drawRectSEL);
+	if(drawRectIMP == class_getMethodImplementation([TUIView class], drawRectSEL) || [view _disableDrawRect])
+		drawRectIMP = NULL;
+
+	OSSpinLockLock(&TUIViewDrawRectIMPsLock);
+	if(!TUIViewDrawRectIMPs)
+		TUIViewDrawRectIMPs = CFDictionaryCreateMutable(NULL, 0, NULL, NULL);
+	CFDictionarySetValue(TUIViewDrawRectIMPs, (__bridge const void *)cls, drawRectIMP);
+	OSSpinLockUnlock(&TUIViewDrawRectIMPsLock);
+
+	return (TUIViewDrawRectIMP)drawRectIMP;
+}
+
+static NSUInteger TUIViewHitTestGeneration = 0;
+
+NSUInteger TUIViewGetHitTestGeneration(void)
+{
+	return TUIViewHitTestGeneration;
+}
+
+static NSTimeInterval TUIViewContentsDiscardInterval = 30.0;
+static NSTimer *TUIViewContentsDiscardTimer = nil;
+// views showing contents they drew, and views whose contents were
+// discarded, neither retained
+static NSHashTable *TUIViewsWithContents = nil;
+static NSHashTable *TUIViewsWithDiscardedContents = nil;
+
+static BOOL TUIViewReportsAvoidableBlending = NO;
+
+static void TUIViewReportAvoidableBlending(TUIView *view, NSString *reason)
+{
+	static NSMutableSet *reportedClasses = nil;
+	@synchronized([TUIView class]) {
+		if(!reportedClasses)
+			reportedClasses = [[NSMutableSet alloc] init];
+		if([reportedClasses containsObject:[view class]])
+			return;
+		[reportedClasses addObject:[view class]];
+	}
+	NSLog(@"%@ is blended but could be opaque: %@. Setting opaque = YES avoids the blending.", view, reason);
+}
+
+// whether every pixel of a premultiplied ARGB context is fully opaque
+static BOOL TUIBitmapContextIsOpaque(CGContextRef context)
+{
+	if(CGBitmapContextGetAlphaInfo(context) != kCGImageAlphaPremultipliedFirst || CGBitmapContextGetBitsPerPixel(context) != 32)
+		return NO;
+
+	const uint8_t *data = CGBitmapContextGetData(context);
+	if(!data)
+		return NO;
+
+	size_t width = CGBitmapContextGetWidth(context);
+	size_t height = CGBitmapContextGetHeight(context);
+	size_t bytesPerRow = CGBitmapContextGetBytesPerRow(context);
+	for(size_t y = 0; y < height; y++) {
+		const uint32_t *row = (const uint32_t *)(data + y * bytesPerRow);
+		for(size_t x = 0; x < width; x++) {
+			if((row[x] >> 24) != 0xFF)
+				return NO;
+		}
+	}
+	return YES;
+}
+
+static NSUInteger TUIViewFramesBeforeFlattening = 30;
+// views with flattensStaticSubviews set; none, and changes skip looking for them
+static NSUInteger TUIViewFlatteningViewCount = 0;
+
+// whether the view and everything under it can be drawn into an
+// ancestor's contents and left out of the render tree
+static BOOL TUIViewCanFlatten(TUIView *view)
+{
+	CALayer *layer = view.layer;
+	if (layer.mask != nil || [view _needsDisplay] || !CATransform3DIsAffine(layer.transform))
+		return NO;
+	// hosted AppKit views and tiles aren't in the view's own layer contents
+	if ([view conformsToProtocol:@protocol(TUIHostView)] || [view _disableDrawRect])
+		return NO;
+
+	// a flattened image ends at the flattening view's bounds
+	CGRect bounds = view.bounds;
+	BOOL clips = layer.masksToBounds;
+	for (TUIView *subview in view.subviews) {
+		if (!clips && !subview.layer.hidden && !CGRectContainsRect(bounds, subview.frame))
+			return NO;
+		if (!TUIViewCanFlatten(subview))
+			return NO;
+	}
+	return YES;
+}
+
+static void TUIViewAddMainRunLoopObserver(CFIndex order, CFRunLoopObserverCallBack callout)
+{
+	CFRunLoopObserverRef observer = CFRunLoopObserverCreate(NULL, kCFRunLoopBeforeWaiting | kCFRunLoopExit, true, order, callout, NULL);
+	CFRunLoopAddObserver(CFRunLoopGetMain(), observer, kCFRunLoopCommonModes);
+	CFRelease(observer);
+}
+
+// views whose frame changed this run loop turn, posted to once each
+static NSMutableArray *TUIViewsWithPendingFrameChanges = nil;
+
+static void TUIViewPostPendingFrameChanges(CFRunLoopObserverRef observer, CFRunLoopActivity activity, void *info)
+{
+	@autoreleasepool {
+		// observers move other views, which are posted in this same pass;
+		// a view posted once already is not posted again, so constraints
+		// that depend on each other settle
+		NSMutableSet *posted = [NSMutableSet set];
+		while([TUIViewsWithPendingFrameChanges count] > 0) {
+			NSArray *views = [TUIViewsWithPendingFrameChanges copy];
+			[TUIViewsWithPendingFrameChanges removeAllObjects];
+			for(TUIView *view in views) {
+				view->_viewFlags.frameChangePending = 0;
+				if([posted containsObject:view])
+					continue;
+				[posted addObject:view];
+				[[NSNotificationCenter defaultCenter] postNotificationName:TUIViewFrameDidChangeNotification object:view];
+			}
+		}
+	}
+}
+
+static void TUIViewEnqueueFrameChange(TUIView *view)
+{
+	if(view->_viewFlags.frameChangePending)
+		return;
+
+	if(!TUIViewsWithPendingFrameChanges) {
+		TUIViewsWithPendingFrameChanges = [[NSMutableArray alloc] init];
+		// ahead of Core Animation's commit of the run loop's implicit
+		// transaction, so whatever observers do shows up in the same frame
+		TUIViewAddMainRunLoopObserver(1999000, TUIViewPostPendingFrameChanges);
+	}
+
+	view->_viewFlags.frameChangePending = 1;
+	[TUIViewsWithPendingFrameChanges addObject:view];
+}
+
+static BOOL TUIViewIsConstrainedToSuperview(TUIView *view)
+{
+	for(TUILayoutConstraint *constraint in [[TUILayoutManager sharedLayoutManager] layoutConstraintsOnView:view]) {
+		if([[constraint sourceName] isEqual:@"superview"])
+			return YES;
+	}
+	return NO;
+}
+
+// views that moved, resized or were laid out this run loop turn, whose
+// subviews have not been sent -ancestorDidLayout yet
+static NSMutableArray *TUIViewsWithPendingAncestorLayout = nil;
+
+static void TUIViewResolvePendingAncestorLayout(CFRunLoopObserverRef observer, CFRunLoopActivity activity, void *info)
+{
+	@autoreleasepool {
+		[CATransaction begin];
+		while([TUIViewsWithPendingAncestorLayout count] > 0) {
+			// lay out the trees the views are in now rather than during the
+			// commit, so views moved by layout are caught in this pass too
+			NSMutableSet *rootLayers = [NSMutableSet set];
+			for(TUIView *view in TUIViewsWithPendingAncestorLayout) {
+				CALayer *root = view.layer;
+				while(root.superlayer)
+					root = root.superlayer;
+				[rootLayers addObject:root];
+			}
+			[rootLayers makeObjectsPerformSelector:@selector(layoutIfNeeded)];
+
+			NSArray *views = [TUIViewsWithPendingAncestorLayout copy];
+			[TUIViewsWithPendingAncestorLayout removeAllObjects];
+			for(TUIView *view in views) {
+				// already reached from a view above it
+				if(!view->_viewFlags.subviewsNeedAncestorLayout)
+					continue;
+
+				// or about to be
+				BOOL ancestorPending = NO;
+				for(TUIView *ancestor = view.superview; ancestor; ancestor = ancestor.superview) {
+					if(ancestor->_viewFlags.subviewsNeedAncestorLayout) {
+						ancestorPending = YES;
+						break;
+					}
+				}
+				if(ancestorPending)
+					continue;
+
+				view->_viewFlags.subviewsNeedAncestorLayout = 0;
+				[view.subviews makeObjectsPerformSelector:@selector(ancestorDidLayout)];
+			}
+		}
+		[CATransaction commit];
+	}
+}
+
+@interface TUIView () {
+	TUISubviewIndex *_subviewIndex;
+
+	// flattening: frames in a row the subtree went unchanged, the clock
+	// counting them, and while flattened, the layer's own contents, the
+	// flattened image shown instead and the subviews it stands in for
+	NSUInteger _staticFrameCount;
+	TUIFrameClock *_flatteningClock;
+	id _unflattenedContents;
+	id _flattenedContents;
+	NSArray *_flattenedSubviews;
+
+	// drawing: the region handed to the latest draw (empty meaning the whole
+	// view), which is drawn again until some draw's result is committed,
+	// and the generations of the latest draw prepared and committed
+	TUIViewDirtyRegion _undrawnRegion;
+	NSUInteger _drawGeneration;
+	NSUInteger _committedDrawGeneration;
+}
+
 @property (nonatomic, strong) NSMutableArray *subviews;
 
 /*
@@ -78,6 +376,14 @@ CGRect(^TUIViewCenteredLayout)(TUIView*) = nil;
  * layer.
  */
 - (void)prepareSubview:(TUIView *)view insertionBlock:(void (^)(void))block;
+- (void)_setSubviewsNeedAncestorLayout;
+- (void)_queueDisplay;
+- (void)_startCountingStaticFrames;
+- (void)_stopCountingStaticFrames;
+- (void)_staticFrame:(TUIFrameClock *)clock;
+- (BOOL)_flattenSubviews;
+- (void)_unflattenSubviews;
+- (BOOL)_commitDrawGeneration:(NSUInteger)generation;
 @end
 
 @implementation TUIView
@@ -86,6 +392,7 @@ CGRect(^TUIViewCenteredLayout)(TUIView*) = nil;
 @synthesize toolTip;
 @synthesize toolTipDelay;
 @synthesize drawQueue;
+@synthesize contentCacheKey;
 // use the accessor from the main implementation block
 @synthesize subviews = _subviews;
 
@@ -109,6 +416,16 @@ static pthread_key_t TUICurrentContextScaleFactorTLSKey;
 {
 	if(self == [TUIView class]) {
 		pthread_key_create(&TUICurrentContextScaleFactorTLSKey, free);
+		TUIViewReportsAvoidableBlending = (getenv("TUIReportAvoidableBlending") != NULL);
+
+		NSPointerFunctionsOptions options = NSPointerFunctionsOpaqueMemory | NSPointerFunctionsObjectPointerPersonality;
+		TUIViewsWithContents = [[NSHashTable alloc] initWithOptions:options capacity:0];
+		TUIViewsWithDiscardedContents = [[NSHashTable alloc] initWithOptions:options capacity:0];
+
+		// bundles may bring categories that replace -drawRect:
+		[[NSNotificationCenter defaultCenter] addObserverForName:NSBundleDidLoadNotification object:nil queue:nil usingBlock:^(NSNotification *notification) {
+			[TUIView drawRectImplementationsDidChange];
+		}];
 
 		TUIViewCenteredLayout = [^(TUIView *v) {
 			TUIView *superview = v.superview;
@@ -140,6 +457,12 @@ static pthread_key_t TUICurrentContextScaleFactorTLSKey;
 		CGContextRelease(_context.context);
 		_context.context = NULL;
 	}
+	CGPDFDocumentRelease(_context.displayList);
+	[TUIViewsWithContents removeObject:self];
+	[TUIViewsWithDiscardedContents removeObject:self];
+	[_flatteningClock removeTarget:self];
+	if(_viewFlags.flattensStaticSubviews)
+		TUIViewFlatteningViewCount--;
 }
 
 - (id)initWithFrame:(CGRect)frame
@@ -194,6 +517,7 @@ static pthread_key_t TUICurrentContextScaleFactorTLSKey;
 - (void)setUserInteractionEnabled:(BOOL)b
 {
 	_viewFlags.userInteractionDisabled = !b;
+	TUIViewHitTestGeneration++;
 }
 
 - (BOOL)moveWindowByDragging
@@ -282,6 +606,7 @@ static pthread_key_t TUICurrentContextScaleFactorTLSKey;
 	NSInteger w = b.size.width;
 	NSInteger h = b.size.height;
 	BOOL o = self.opaque;
+	TUIBackingStoreFormat f = _context.format;
 	CGFloat currentScale = [self.layer respondsToSelector:@selector(contentsScale)] ? self.layer.contentsScale : 1.0f;
 	
 	if(_context.context) {
@@ -289,6 +614,7 @@ static pthread_key_t TUICurrentContextScaleFactorTLSKey;
 		if(w != _context.lastWidth || 
 		   h != _context.lastHeight ||
 		   o != _context.lastOpaque ||
+		   f != _context.lastFormat ||
 		   fabs(currentScale - _context.lastContentsScale) > 0.1f) 
 		{
 			CGContextRelease(_context.context);
@@ -301,13 +627,14 @@ static pthread_key_t TUICurrentContextScaleFactorTLSKey;
 		_context.lastWidth = w;
 		_context.lastHeight = h;
 		_context.lastOpaque = o;
+		_context.lastFormat = f;
 		_context.lastContentsScale = currentScale;
 
 		b.size.width *= currentScale;
 		b.size.height *= currentScale;
 		if(b.size.width < 1) b.size.width = 1;
 		if(b.size.height < 1) b.size.height = 1;
-		CGContextRef ctx = TUICreateGraphicsContextWithOptions(b.size, o);
+		CGContextRef ctx = TUICreateGraphicsContextWithFormat(b.size, o, f);
 		_context.context = ctx;
 	}
 	
@@ -326,7 +653,7 @@ CGFloat TUICurrentContextScaleFactor(void)
 	return 1.0;
 }
 
-static void TUISetCurrentContextScaleFactor(CGFloat s)
+void TUISetCurrentContextScaleFactor(CGFloat s)
 {
 	CGFloat *v = pthread_getspecific(TUICurrentContextScaleFactorTLSKey);
 	if(!v) {
@@ -336,36 +663,514 @@ static void TUISetCurrentContextScaleFactor(CGFloat s)
 	*v = s;
 }
 
+static CGFloat TUIRectArea(CGRect r)
+{
+	return r.size.width * r.size.height;
+}
+
+static void TUIDirtyRegionAddRect(TUIViewDirtyRegion *region, CGRect rect)
+{
+	if (CGRectIsEmpty(rect))
+		return;
+	if (!CGRectIsInfinite(rect))
+		rect = CGRectIntegral(rect);
+
+	NSUInteger count = 0;
+	CGRect rects[TUIViewMaximumDirtyRects + 1];
+	for (NSUInteger i = 0; i < region->count; i++) {
+		if (CGRectContainsRect(region->rects[i], rect))
+			return;
+		if (!CGRectContainsRect(rect, region->rects[i]))
+			rects[count++] = region->rects[i];
+	}
+	rects[count++] = rect;
+
+	// too fragmented, merge the pair whose union covers the least extra area
+	while (count > TUIViewMaximumDirtyRects) {
+		NSUInteger bestA = 0, bestB = 1;
+		CGFloat bestWaste = CGFLOAT_MAX;
+		for (NSUInteger a = 0; a < count; a++) {
+			for (NSUInteger b = a + 1; b < count; b++) {
+				CGFloat waste = TUIRectArea(CGRectUnion(rects[a], rects[b])) - TUIRectArea(rects[a]) - TUIRectArea(rects[b]);
+				if (waste < bestWaste) {
+					bestWaste = waste;
+					bestA = a;
+					bestB = b;
+				}
+			}
+		}
+		rects[bestA] = CGRectUnion(rects[bestA], rects[bestB]);
+		rects[bestB] = rects[--count];
+	}
+
+	memcpy(region->rects, rects, count * sizeof(CGRect));
+	region->count = count;
+}
+
+/**
+ * @internal
+ * @brief Keep a display list recorded by a draw, unless the content was invalidated after that draw began
+ */
+- (void)_setDisplayList:(id)displayList generation:(NSUInteger)generation
+{
+	if (generation != _context.displayListGeneration || !_viewFlags.recordsDrawing)
+		return;
+	if ((__bridge CGPDFDocumentRef)displayList == _context.displayList)
+		return;
+
+	CGPDFDocumentRelease(_context.displayList);
+	_context.displayList = CGPDFDocumentRetain((__bridge CGPDFDocumentRef)displayList);
+}
+
+/**
+ * @internal
+ * @brief Throw away the recorded display list, the next display calls -drawRect: again
+ */
+- (void)_invalidateDisplayList
+{
+	_context.displayListGeneration++;
+	if (_context.displayList) {
+		CGPDFDocumentRelease(_context.displayList);
+		_context.displayList = NULL;
+	}
+}
+
+/**
+ * @internal
+ * @brief Redisplay the whole view, replaying its display list if it has one
+ */
+- (void)_setNeedsRedisplay
+{
+	TUIDirtyRegionAddRect(&_context.dirtyRegion, CGRectInfinite);
+	[self _queueDisplay];
+}
+
+/**
+ * @internal
+ * @brief Have the view displayed by the display pass, or by Core Animation off the main thread
+ */
+- (void)_queueDisplay
+{
+	if ([NSThread isMainThread])
+		[[TUIDisplayPass sharedDisplayPass] setNeedsDisplayForView:self];
+	else
+		[self.layer setNeedsDisplay];
+}
+
+- (BOOL)_needsDisplay
+{
+	return self.layer.needsDisplay || [[TUIDisplayPass sharedDisplayPass] needsDisplayForView:self];
+}
+
+/**
+ * @internal
+ * @brief How urgently a background draw is wanted: 2 if any of the view is on screen, 1 if it is in a window but scrolled out of view, 0 otherwise
+ */
+- (CGFloat)_drawPriority
+{
+	if (!self.nsView || !self.nsWindow)
+		return 0.0;
+	return [self _isVisible] ? 2.0 : 1.0;
+}
+
+/**
+ * @internal
+ * @brief Whether any of the view is in sight: in a visible window, not hidden, and not clipped away by its ancestors or its TUINSView
+ */
+- (BOOL)_isVisible
+{
+	TUINSView *view = self.nsView;
+	NSWindow *window = self.nsWindow;
+	if (!view || !window || ![window isVisible] || [window isMiniaturized] || [view isHiddenOrHasHiddenAncestor])
+		return NO;
+
+	CGRect visible = self.bounds;
+	for (TUIView *v = self; v != nil; v = v.superview) {
+		if (v.hidden)
+			return NO;
+		if (v != self)
+			visible = CGRectIntersection(visible, [self convertRect:v.bounds fromView:v]);
+		if (CGRectIsEmpty(visible))
+			return NO;
+	}
+
+	visible = [self convertRect:visible toView:nil];
+	return !CGRectIsEmpty(CGRectIntersection(visible, [view bounds]));
+}
+
+/**
+ * @internal
+ * @brief Note that the view shows contents it drew, which may be discarded once it has been out of sight long enough
+ */
+- (void)_didDisplayContents
+{
+	[self _subtreeDidChange];
+	_context.lastVisibleTime = CFAbsoluteTimeGetCurrent();
+	_viewFlags.contentsDiscarded = 0;
+	[TUIViewsWithDiscardedContents removeObject:self];
+	[TUIViewsWithContents addObject:self];
+
+	if (!TUIViewContentsDiscardTimer && TUIViewContentsDiscardInterval > 0.0) {
+		TUIViewContentsDiscardTimer = [NSTimer scheduledTimerWithTimeInterval:TUIViewContentsDiscardInterval / 2.0 target:[TUIView class] selector:@selector(_discardContentsOutOfSight:) userInfo:nil repeats:YES];
+	}
+}
+
+/**
+ * @internal
+ * @brief Discard the contents of views out of sight for longer than the discard interval, and bring back those of views back in sight
+ */
++ (void)_discardContentsOutOfSight:(NSTimer *)timer
+{
+	CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+
+	for (TUIView *view in [TUIViewsWithContents allObjects]) {
+		if ([view _isVisible]) {
+			view->_context.lastVisibleTime = now;
+		} else if (now - view->_context.lastVisibleTime >= TUIViewContentsDiscardInterval) {
+			[view _discardOwnContents];
+		}
+	}
+
+	// catches windows being ordered back in, which nothing else reports
+	for (TUIView *view in [TUIViewsWithDiscardedContents allObjects])
+		[view _restoreDiscardedContentsIfVisible];
+
+	if ([TUIViewsWithContents count] == 0 && [TUIViewsWithDiscardedContents count] == 0) {
+		[TUIViewContentsDiscardTimer invalidate];
+		TUIViewContentsDiscardTimer = nil;
+	}
+}
+
++ (NSTimeInterval)contentsDiscardInterval
+{
+	return TUIViewContentsDiscardInterval;
+}
+
++ (void)setContentsDiscardInterval:(NSTimeInterval)interval
+{
+	TUIViewContentsDiscardInterval = MAX(0.0, interval);
+
+	[TUIViewContentsDiscardTimer invalidate];
+	TUIViewContentsDiscardTimer = nil;
+	if (TUIViewContentsDiscardInterval > 0.0 && [TUIViewsWithContents count] > 0) {
+		TUIViewContentsDiscardTimer = [NSTimer scheduledTimerWithTimeInterval:TUIViewContentsDiscardInterval / 2.0 target:[TUIView class] selector:@selector(_discardContentsOutOfSight:) userInfo:nil repeats:YES];
+	}
+}
+
+- (void)discardContents
+{
+	[self.subviews makeObjectsPerformSelector:_cmd];
+	[self _discardOwnContents];
+}
+
+/**
+ * @internal
+ * @brief Release the contents this view drew, not touching its subviews
+ */
+- (void)_discardOwnContents
+{
+	[self _unflattenSubviews];
+	if (![TUIViewsWithContents containsObject:self])
+		return;
+
+	[[TUIDrawScheduler sharedScheduler] cancelDrawForOwner:self];
+
+	[CATransaction begin];
+	[CATransaction setDisableActions:YES];
+	self.layer.contents = nil;
+	[CATransaction commit];
+
+	_viewFlags.contentsDiscarded = 1;
+	[TUIViewsWithContents removeObject:self];
+	[TUIViewsWithDiscardedContents addObject:self];
+}
+
+- (BOOL)flattensStaticSubviews
+{
+	return _viewFlags.flattensStaticSubviews;
+}
+
+- (void)setFlattensStaticSubviews:(BOOL)flattens
+{
+	if (_viewFlags.flattensStaticSubviews == flattens)
+		return;
+
+	_viewFlags.flattensStaticSubviews = flattens;
+	if (flattens) {
+		TUIViewFlatteningViewCount++;
+		[self _startCountingStaticFrames];
+	} else {
+		TUIViewFlatteningViewCount--;
+		[self _stopCountingStaticFrames];
+		[self _unflattenSubviews];
+	}
+}
+
++ (NSUInteger)framesBeforeFlattening
+{
+	return TUIViewFramesBeforeFlattening;
+}
+
++ (void)setFramesBeforeFlattening:(NSUInteger)frames
+{
+	TUIViewFramesBeforeFlattening = MAX(1, frames);
+}
+
+- (void)_subtreeDidChange
+{
+	if (TUIViewFlatteningViewCount == 0)
+		return;
+
+	for (TUIView *v = self; v != nil; v = v.superview) {
+		if (v->_viewFlags.flattensStaticSubviews) {
+			[v _unflattenSubviews];
+			[v _startCountingStaticFrames];
+		}
+	}
+}
+
+/**
+ * @internal
+ * @brief Count frames from zero again, flattening once enough of them pass without a change
+ */
+- (void)_startCountingStaticFrames
+{
+	_staticFrameCount = 0;
+	if (_flatteningClock || !_viewFlags.flattensStaticSubviews || !self.nsWindow || [_subviews count] == 0)
+		return;
+
+	_flatteningClock = [TUIFrameClock addTarget:self action:@selector(_staticFrame:) forWindow:self.nsWindow];
+}
+
+- (void)_stopCountingStaticFrames
+{
+	[_flatteningClock removeTarget:self];
+	_flatteningClock = nil;
+}
+
+- (void)_staticFrame:(TUIFrameClock *)clock
+{
+	if (++_staticFrameCount < TUIViewFramesBeforeFlattening)
+		return;
+
+	// keep trying each frame while drawing is still pending
+	if ([self _needsDisplay] || _context.dirtyRegion.count > 0)
+		return;
+
+	[self _stopCountingStaticFrames];
+	[self _flattenSubviews];
+}
+
+/**
+ * @internal
+ * @brief Draw the visible, opaque-alpha subviews on top of the view's own contents and hide their layers
+ */
+- (BOOL)_flattenSubviews
+{
+	if (_viewFlags.subviewsFlattened || !self.nsWindow)
+		return NO;
+
+	// only contents drawn into a bitmap filling the bounds can be drawn on
+	// top of
+	CALayer *selfLayer = self.layer;
+	id contents = selfLayer.contents;
+	if (contents != nil) {
+		if (CFGetTypeID((__bridge CFTypeRef)contents) != CGImageGetTypeID())
+			return NO;
+		if (![selfLayer.contentsGravity isEqualToString:kCAGravityResize] || !CGRectEqualToRect(selfLayer.contentsRect, CGRectMake(0, 0, 1, 1)))
+			return NO;
+	}
+
+	CGRect b = self.bounds;
+	BOOL clips = selfLayer.masksToBounds;
+	NSMutableArray *subviews = [NSMutableArray array];
+	for (TUIView *subview in [self sortedSubviews]) {
+		if (subview.layer.hidden)
+			continue;
+		// subviews left live stay on top of the image, so only the run from
+		// the back up to the first one that can't be flattened goes in it;
+		// anything past the bounds would be cut off by the image
+		if (subview.layer.opacity < 1.0f || (!clips && !CGRectContainsRect(b, subview.frame)) || !TUIViewCanFlatten(subview))
+			break;
+		[subviews addObject:subview];
+	}
+	if ([subviews count] == 0)
+		return NO;
+
+	// without contents the layer shows only its background color. An
+	// opaque one is painted in, so the image can be opaque too; otherwise
+	// the image is left clear around the subviews and the layer's own
+	// background shows through
+	CGColorRef backgroundColor = selfLayer.backgroundColor;
+	BOOL opaqueBackground = (backgroundColor != NULL && CGColorGetAlpha(backgroundColor) >= 1.0);
+	BOOL opaque = (contents != nil || opaqueBackground);
+	// a layer marked opaque must not be handed an image with clear pixels
+	if (self.opaque && !opaque)
+		return NO;
+	opaque = opaque && self.opaque;
+
+	CGFloat scale = [selfLayer respondsToSelector:@selector(contentsScale)] ? selfLayer.contentsScale : 1.0f;
+	CGContextRef context = TUICreateGraphicsContextWithOptions(CGSizeMake(b.size.width * scale, b.size.height * scale), opaque);
+	if (!context)
+		return NO;
+
+	CGContextScaleCTM(context, scale, scale);
+	if (contents != nil) {
+		CGContextDrawImage(context, CGRectMake(0, 0, b.size.width, b.size.height), (__bridge CGImageRef)contents);
+	} else if (opaqueBackground) {
+		CGContextSetFillColorWithColor(context, backgroundColor);
+		CGContextFillRect(context, CGRectMake(0, 0, b.size.width, b.size.height));
+	}
+
+	CGContextTranslateCTM(context, -b.origin.x, -b.origin.y);
+	for (TUIView *subview in subviews) {
+		CALayer *layer = subview.layer;
+		CGRect sb = layer.bounds;
+		CGPoint anchor = layer.anchorPoint;
+
+		CGContextSaveGState(context);
+		CGContextTranslateCTM(context, layer.position.x, layer.position.y);
+		CGContextConcatCTM(context, CATransform3DGetAffineTransform(layer.transform));
+		CGContextTranslateCTM(context, -sb.size.width * anchor.x - sb.origin.x, -sb.size.height * anchor.y - sb.origin.y);
+		[subview _drawSnapshotInContext:context];
+		CGContextRestoreGState(context);
+	}
+
+	CGImageRef image = TUICreateCGImageFromBitmapContext(context);
+	CGContextRelease(context);
+	if (!image)
+		return NO;
+
+	_unflattenedContents = contents;
+	_flattenedContents = CFBridgingRelease(image);
+	_flattenedSubviews = subviews;
+	_viewFlags.subviewsFlattened = 1;
+
+	[CATransaction begin];
+	[CATransaction setDisableActions:YES];
+	self.layer.contents = _flattenedContents;
+	for (TUIView *subview in subviews) {
+		subview->_viewFlags.hiddenByFlattening = 1;
+		subview.layer.hidden = YES;
+	}
+	[CATransaction commit];
+
+	return YES;
+}
+
+/**
+ * @internal
+ * @brief Put the flattened subviews' layers back and the view's own contents with them
+ */
+- (void)_unflattenSubviews
+{
+	if (!_viewFlags.subviewsFlattened)
+		return;
+
+	[CATransaction begin];
+	[CATransaction setDisableActions:YES];
+	for (TUIView *subview in _flattenedSubviews) {
+		if (subview->_viewFlags.hiddenByFlattening) {
+			subview->_viewFlags.hiddenByFlattening = 0;
+			subview.layer.hidden = NO;
+		}
+	}
+	// unless something displayed over the flattened image meanwhile
+	if (self.layer.contents == _flattenedContents)
+		self.layer.contents = _unflattenedContents;
+	[CATransaction commit];
+
+	_viewFlags.subviewsFlattened = 0;
+	_unflattenedContents = nil;
+	_flattenedContents = nil;
+	_flattenedSubviews = nil;
+}
+
+- (void)_restoreDiscardedContentsIfVisible
+{
+	if (!_viewFlags.contentsDiscarded || ![self _isVisible])
+		return;
+
+	_viewFlags.contentsDiscarded = 0;
+	[TUIViewsWithDiscardedContents removeObject:self];
+	[self _setNeedsRedisplay];
+}
+
 - (void)displayLayer:(CALayer *)layer
 {
-	typedef void (*DrawRectIMP)(id,SEL,CGRect);
 	SEL drawRectSEL = @selector(drawRect:);
-	DrawRectIMP drawRectIMP = (DrawRectIMP)[self methodForSelector:drawRectSEL];
-	DrawRectIMP dontCallThisBasicDrawRectIMP = (DrawRectIMP)[TUIView instanceMethodForSelector:drawRectSEL];
+	TUIViewDrawRectIMP drawRectIMP = TUIViewGetDrawRectIMP(self);
 
-	if (!self.drawRect && (drawRectIMP == dontCallThisBasicDrawRectIMP || [self _disableDrawRect])) {
-		// drawRect isn't overridden by subclass, don't call, let the CA machinery just handle backgroundColor (fast path)
+	if (!drawRect && !drawRectIMP) {
+		// nothing to draw, let the CA machinery just handle backgroundColor (fast path)
 		return;
 	}
 
-	void (^drawBlock)(void) = ^{
-		if (_viewFlags.delegateWillDisplayLayer) {
-			[_viewDelegate viewWillDisplayLayer:self];
+	// draw on top of the view's own pixels, not a flattened image
+	[self _unflattenSubviews];
+
+	// content drawn before, by this view or another, is reused as is
+	TUIViewContentCacheKey *cacheKey = nil;
+	if (contentCacheKey != nil) {
+		CGFloat scale = [layer respondsToSelector:@selector(contentsScale)] ? layer.contentsScale : 1.0f;
+		cacheKey = [[TUIViewContentCacheKey alloc] initWithContentKey:contentCacheKey size:self.bounds.size scale:scale opaque:self.opaque];
+		id cachedContents = [TUIViewContentCache() objectForKey:cacheKey];
+
+		// a cached image is complete, and so is anything drawn to cache
+		_context.dirtyRegion.count = 0;
+
+		if (cachedContents != nil) {
+			[[TUIDrawScheduler sharedScheduler] cancelDrawForOwner:self];
+			_committedDrawGeneration = _drawGeneration;
+			if ([NSThread isMainThread])
+				[self _didDisplayContents];
+			layer.contents = cachedContents;
+			return;
+		}
+	}
+
+	// the last image's pixels are only copied if part of them is kept
+	id previousContents = layer.contents;
+
+	// draws into a context of its own and returns the result, so it may run
+	// on any thread
+	CGImageRef (^renderBlock)(CGContextRef, TUIViewDirtyRegion, id *) = ^(CGContextRef context, TUIViewDirtyRegion region, id *displayList) {
+		// only the dirty rects are redrawn, on top of the last image's pixels;
+		// without usable pixels to draw on top of, everything is
+		BOOL partial = NO;
+		if (region.count > 0 && previousContents && CFGetTypeID((__bridge CFTypeRef)previousContents) == CGImageGetTypeID()) {
+			CGImageRef previousImage = (__bridge CGImageRef)previousContents;
+			partial = [[TUIBackingStorePool sharedPool] copyPixelsOfImage:previousImage toContext:context];
+			if (!partial) {
+				size_t w = CGBitmapContextGetWidth(context);
+				size_t h = CGBitmapContextGetHeight(context);
+				if (CGImageGetWidth(previousImage) == w && CGImageGetHeight(previousImage) == h) {
+					CGContextSaveGState(context);
+					CGContextSetBlendMode(context, kCGBlendModeCopy);
+					CGContextDrawImage(context, CGRectMake(0, 0, w, h), previousImage);
+					CGContextRestoreGState(context);
+					partial = YES;
+				}
+			}
 		}
 
 		CGRect rectToDraw = self.bounds;
-		if (!CGRectEqualToRect(_context.dirtyRect, CGRectZero)) {
-			rectToDraw = _context.dirtyRect;
-			_context.dirtyRect = CGRectZero;
+		if (partial) {
+			rectToDraw = region.rects[0];
+			for (NSUInteger i = 1; i < region.count; i++)
+				rectToDraw = CGRectUnion(rectToDraw, region.rects[i]);
 		}
 
-		CGContextRef context = [self _CGContext];
 		TUIGraphicsPushContext(context);
 
 		CGFloat scale = [self.layer respondsToSelector:@selector(contentsScale)] ? self.layer.contentsScale : 1.0f;
 		TUISetCurrentContextScaleFactor(scale);
 		CGContextScaleCTM(context, scale, scale);
 
+		if (partial) {
+			CGContextClipToRects(context, region.rects, region.count);
+		}
+
 		if (_viewFlags.clearsContextBeforeDrawing) {
 			CGContextClearRect(context, rectToDraw);
 		}
@@ -374,14 +1179,39 @@ static void TUISetCurrentContextScaleFactor(CGFloat s)
 		CGContextSetShouldAntialias(context, true);
 		CGContextSetShouldSmoothFonts(context, !_viewFlags.disableSubpixelTextRendering);
 
-		if (self.drawRect) {
+		if (displayList) {
+			// record everything once, then replay whatever part is needed
+			CGRect bounds = self.bounds;
+			CGPDFPageRef page = (*displayList != nil) ? CGPDFDocumentGetPage((__bridge CGPDFDocumentRef)*displayList, 1) : NULL;
+			if (!page || !CGRectEqualToRect(CGPDFPageGetBoxRect(page, kCGPDFMediaBox), bounds)) {
+				NSData *data = TUIGraphicsDrawAsPDF(&bounds, ^(CGContextRef pdf) {
+					TUISetCurrentContextScaleFactor(scale);
+					if (self.drawRect) {
+						self.drawRect(self, bounds);
+					} else if (drawRectIMP) {
+						drawRectIMP(self, drawRectSEL, bounds);
+					}
+				});
+				CGDataProviderRef provider = CGDataProviderCreateWithCFData((__bridge CFDataRef)data);
+				CGPDFDocumentRef document = CGPDFDocumentCreateWithProvider(provider);
+				CGDataProviderRelease(provider);
+				*displayList = CFBridgingRelease(document);
+				page = (document != NULL) ? CGPDFDocumentGetPage(document, 1) : NULL;
+			}
+
+			if (page)
+				CGContextDrawPDFPage(context, page);
+		} else if (self.drawRect) {
 			// drawRect is implemented via a block
 			self.drawRect(self, rectToDraw);
-		} else if ((drawRectIMP != dontCallThisBasicDrawRectIMP) && ![self _disableDrawRect]) {
+		} else if (drawRectIMP) {
 			// drawRect is overridden by subclass
 			drawRectIMP(self, drawRectSEL, rectToDraw);
 		}
 
+		if (TUIViewReportsAvoidableBlending && !partial && !self.opaque && TUIBitmapContextIsOpaque(context))
+			TUIViewReportAvoidableBlending(self, @"everything it draws is opaque");
+
 		#if CA_COLOR_OVERLAY_DEBUG
 		if (self.opaque) {
 			CGContextSetRGBFillColor(context, 0, 1, 0, 0.3);
@@ -391,20 +1221,142 @@ static void TUISetCurrentContextScaleFactor(CGFloat s)
 		CGContextFillRect(context, rectToDraw);
 		#endif
 
-		layer.contents = TUIGraphicsGetImageFromCurrentImageContext();
-		CGContextScaleCTM(context, 1.0f / scale, 1.0f / scale);
 		TUIGraphicsPopContext();
 
-		if (self.drawInBackground) [CATransaction flush];
+		// hand the buffer itself to the layer rather than a copy of it; the
+		// next display draws into a fresh one from the pool
+		return [[TUIBackingStorePool sharedPool] createImageByDetachingContext:context];
+	};
+
+	// runs on the main thread: takes the dirty region and a context off the
+	// view, so a draw still running in the background never shares them
+	CGContextRef (^prepareBlock)(TUIViewDirtyRegion *, NSUInteger *) = ^(TUIViewDirtyRegion *region, NSUInteger *generation) {
+		if (_viewFlags.delegateWillDisplayLayer) {
+			[_viewDelegate viewWillDisplayLayer:self];
+		}
+
+		// an empty region means the whole view, as does one covering it.
+		// Until a draw is committed, what it was handed is drawn again: a
+		// draw that gets superseded never makes it on screen
+		CGRect bounds = self.bounds;
+		TUIViewDirtyRegion dirty = _context.dirtyRegion;
+		BOOL whole = (dirty.count == 0);
+		if (_drawGeneration != _committedDrawGeneration) {
+			if (_undrawnRegion.count == 0)
+				whole = YES;
+			for (NSUInteger i = 0; i < _undrawnRegion.count; i++)
+				TUIDirtyRegionAddRect(&dirty, _undrawnRegion.rects[i]);
+		}
+		region->count = 0;
+		for (NSUInteger i = 0; !whole && i < dirty.count; i++) {
+			CGRect r = CGRectIntersection(dirty.rects[i], bounds);
+			if (CGRectEqualToRect(r, bounds)) {
+				region->count = 0;
+				break;
+			}
+			if (!CGRectIsEmpty(r))
+				region->rects[region->count++] = r;
+		}
+		_context.dirtyRegion.count = 0;
+		_undrawnRegion = *region;
+		*generation = ++_drawGeneration;
+
+		[self _didDisplayContents];
+
+		CGContextRef context = [self _CGContext];
+		_context.context = NULL;
+		return context;
+	};
+
+	// draws through the view's display list when it records drawing, and
+	// returns the (possibly newly recorded) list to keep
+	CGImageRef (^recordingRenderBlock)(CGContextRef, TUIViewDirtyRegion, id, __strong id *) = ^(CGContextRef context, TUIViewDirtyRegion region, id displayList, __strong id *newDisplayList) {
+		CGImageRef image = NULL;
+		@autoreleasepool {
+			if (newDisplayList) {
+				id list = displayList;
+				image = renderBlock(context, region, &list);
+				*newDisplayList = list;
+			} else {
+				image = renderBlock(context, region, NULL);
+			}
+		}
+
+		if (cacheKey != nil && image != NULL) {
+			NSUInteger cost = CGImageGetBytesPerRow(image) * CGImageGetHeight(image);
+			[TUIViewContentCache() setObject:(__bridge id)image forKey:cacheKey cost:cost];
+		}
+		return image;
+	};
+
+	BOOL recordsDrawing = _viewFlags.recordsDrawing;
+	NSUInteger displayListGeneration = _context.displayListGeneration;
+	id displayList = (__bridge id)_context.displayList;
+
+	void (^drawBlock)(void) = ^{
+		TUIViewDirtyRegion region;
+		NSUInteger generation;
+		CGContextRef context = prepareBlock(&region, &generation);
+		[self _commitDrawGeneration:generation];
+		if (recordsDrawing) {
+			id newDisplayList = nil;
+			CGImageRef image = recordingRenderBlock(context, region, displayList, &newDisplayList);
+			[self _setDisplayList:newDisplayList generation:displayListGeneration];
+			layer.contents = (__bridge id)image;
+			CGImageRelease(image);
+		} else {
+			CGImageRef image = recordingRenderBlock(context, region, nil, NULL);
+			layer.contents = (__bridge id)image;
+			CGImageRelease(image);
+		}
 	};
 	
 	if (self.drawInBackground) {
-		layer.contents = nil;
-		
+		// keep showing the old contents until the new ones are ready
+		TUIViewDirtyRegion region;
+		NSUInteger generation;
+		CGContextRef context = prepareBlock(&region, &generation);
+
 		if (self.drawQueue != nil) {
-			[self.drawQueue addOperationWithBlock:drawBlock];
+			[self.drawQueue addOperationWithBlock:^{
+				id newDisplayList = nil;
+				CGImageRef image = recordingRenderBlock(context, region, displayList, recordsDrawing ? &newDisplayList : NULL);
+				dispatch_async(dispatch_get_main_queue(), ^{
+					// a queue may finish draws out of order; a newer one has
+					// already drawn everything this one did
+					if (![self _commitDrawGeneration:generation]) {
+						CGImageRelease(image);
+						return;
+					}
+					if (recordsDrawing)
+						[self _setDisplayList:newDisplayList generation:displayListGeneration];
+					// ancestors flattened since the draw began show the old contents
+					[self _subtreeDidChange];
+					layer.contents = (__bridge id)image;
+					CGImageRelease(image);
+				});
+			}];
 		} else {
-			dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), drawBlock);
+			__block id newDisplayList = nil;
+			[[TUIDrawScheduler sharedScheduler] scheduleDrawForOwner:self priority:^{
+				return [self _drawPriority];
+			} draw:^id{
+				id list = nil;
+				CGImageRef image = recordingRenderBlock(context, region, displayList, recordsDrawing ? &list : NULL);
+				newDisplayList = list;
+				return CFBridgingRelease(image);
+			} commit:^(id image) {
+				if (![self _commitDrawGeneration:generation])
+					return;
+				if (recordsDrawing)
+					[self _setDisplayList:newDisplayList generation:displayListGeneration];
+				[self _subtreeDidChange];
+				layer.contents = image;
+			} discard:^{
+				// the context and its pooled buffer were only ever going to be
+				// released by the draw
+				CGContextRelease(context);
+			}];
 		}
 	} else if ([NSThread isMainThread] || dispatch_get_current_queue() == dispatch_get_main_queue()) {
 		drawBlock();
@@ -416,6 +1368,33 @@ static void TUISetCurrentContextScaleFactor(CGFloat s)
 	}
 }
 
+/**
+ * @internal
+ * @brief Record a draw's result as shown, unless a newer draw's already is
+ * @return Whether the result should be shown
+ */
+- (BOOL)_commitDrawGeneration:(NSUInteger)generation
+{
+	if (generation <= _committedDrawGeneration)
+		return NO;
+	_committedDrawGeneration = generation;
+	return YES;
+}
+
+- (void)_finishPendingDraw
+{
+	if (_drawGeneration == _committedDrawGeneration)
+		return;
+
+	// the background draw is superseded by this one, and dropped when (or
+	// if) it finishes
+	[[TUIDrawScheduler sharedScheduler] cancelDrawForOwner:self];
+	BOOL drawInBackground = _viewFlags.drawInBackground;
+	_viewFlags.drawInBackground = 0;
+	[self displayLayer:self.layer];
+	_viewFlags.drawInBackground = drawInBackground;
+}
+
 - (void)_blockLayout
 {
 	for(TUIView *v in self.subviews) {
@@ -434,9 +1413,10 @@ static void TUISetCurrentContextScaleFactor(CGFloat s)
 
 - (void)layoutSublayersOfLayer:(CALayer *)layer
 {
+	[_subviewIndex subviewGeometryDidChange];
 	[self layoutSubviews];
 	[self _blockLayout];
-	[self.subviews makeObjectsPerformSelector:@selector(ancestorDidLayout)];
+	[self _setSubviewsNeedAncestorLayout];
 }
 
 - (BOOL)drawInBackground
@@ -449,6 +1429,56 @@ static void TUISetCurrentContextScaleFactor(CGFloat s)
 	_viewFlags.drawInBackground = drawInBackground;
 }
 
+- (void)setContentCacheKey:(id<NSCopying>)key
+{
+	if (key == contentCacheKey || [(id)key isEqual:contentCacheKey])
+		return;
+
+	contentCacheKey = [key copyWithZone:nil];
+	[self _setNeedsRedisplay];
+}
+
++ (NSUInteger)contentCacheByteLimit
+{
+	return [TUIViewContentCache() totalCostLimit];
+}
+
++ (void)setContentCacheByteLimit:(NSUInteger)limit
+{
+	[TUIViewContentCache() setTotalCostLimit:limit];
+}
+
++ (void)removeAllCachedContent
+{
+	[TUIViewContentCache() removeAllObjects];
+}
+
+- (TUIBackingStoreFormat)backingStoreFormat
+{
+	return _context.format;
+}
+
+- (void)setBackingStoreFormat:(TUIBackingStoreFormat)format
+{
+	if (format == _context.format)
+		return;
+
+	_context.format = format;
+	[self setNeedsDisplay];
+}
+
+- (BOOL)recordsDrawing
+{
+	return _viewFlags.recordsDrawing;
+}
+
+- (void)setRecordsDrawing:(BOOL)recordsDrawing
+{
+	_viewFlags.recordsDrawing = recordsDrawing;
+	if (!recordsDrawing)
+		[self _invalidateDisplayList];
+}
+
 - (NSTimeInterval)toolTipDelay
 {
 	return toolTipDelay;
@@ -559,7 +1589,7 @@ static void TUISetCurrentContextScaleFactor(CGFloat s)
 		
 		if([self.layer respondsToSelector:@selector(setContentsScale:)]) {
 			self.layer.contentsScale = scale;
-			[self setNeedsDisplay];
+			[self _setNeedsRedisplay];
 		}
 	}
 }
@@ -575,11 +1605,18 @@ static void TUISetCurrentContextScaleFactor(CGFloat s)
 	/* will call willAdd:nil and didAdd (nil) */
 	[view removeFromSuperview];
 
+	[self _subtreeDidChange];
 	[view willMoveToTUINSView:_nsView];
 	[view willMoveToSuperview:self];
 	view.nsView = _nsView;
 
 	block();
+	[_subviewIndex didInsertSubview:view];
+
+	// constraints may be relative to the new superview
+	if(TUIViewIsConstrainedToSuperview(view))
+		_viewFlags.postsFrameChangesForSubviewConstraints = 1;
+	TUIViewHitTestGeneration++;
 
 	[self didAddSubview:view];
 	[view didMoveToSuperview];
@@ -601,9 +1638,16 @@ static void TUISetCurrentContextScaleFactor(CGFloat s)
 
 - (void)setFrame:(CGRect)f
 {
+	CGSize size = self.layer.bounds.size;
 	self.layer.frame = f;
-	[self.subviews makeObjectsPerformSelector:@selector(ancestorDidLayout)];
-    [[NSNotificationCenter defaultCenter] postNotificationName:TUIViewFrameDidChangeNotification object:self];
+	[self _didChangeGeometry];
+	// a flattened image is laid out for the old size, and so are the
+	// subviews drawn into it
+	if(!CGSizeEqualToSize(size, self.layer.bounds.size))
+		[self _subtreeDidChange];
+	[self _setSubviewsNeedAncestorLayout];
+	if(_viewFlags.postsFrameChangedNotifications || _viewFlags.postsFrameChangesForSubviewConstraints)
+		TUIViewEnqueueFrameChange(self);
 }
 
 - (CGRect)bounds
@@ -613,8 +1657,12 @@ static void TUISetCurrentContextScaleFactor(CGFloat s)
 
 - (void)setBounds:(CGRect)b
 {
+	CGRect old = self.layer.bounds;
 	self.layer.bounds = b;
-	[self.subviews makeObjectsPerformSelector:@selector(ancestorDidLayout)];
+	[self _didChangeGeometry];
+	if(!CGRectEqualToRect(old, b))
+		[self _subtreeDidChange];
+	[self _setSubviewsNeedAncestorLayout];
 }
 
 - (void)setCenter:(CGPoint)c
@@ -623,7 +1671,6 @@ static void TUISetCurrentContextScaleFactor(CGFloat s)
 	f.origin.x = c.x - f.size.width / 2;
 	f.origin.y = c.y - f.size.height / 2;
 	self.frame = f;
-	[self.subviews makeObjectsPerformSelector:@selector(ancestorDidLayout)];
 }
 
 - (CGPoint)center
@@ -640,19 +1687,118 @@ static void TUISetCurrentContextScaleFactor(CGFloat s)
 - (void)setTransform:(CGAffineTransform)t
 {
 	[self.layer setAffineTransform:t];
+	[self _didChangeGeometry];
+}
+
+- (CGFloat)zPosition
+{
+	return self.layer.zPosition;
+}
+
+- (void)setZPosition:(CGFloat)z
+{
+	if(z == self.layer.zPosition)
+		return;
+
+	self.layer.zPosition = z;
+	TUIViewHitTestGeneration++;
+
+	TUIView *superview = self.superview;
+	if(superview)
+		[superview->_subviewIndex subviewZPositionDidChange];
+}
+
+/**
+ * @internal
+ * @brief Let the spatial indexes know this view's frame changed
+ */
+- (void)_didChangeGeometry
+{
+	TUIViewHitTestGeneration++;
+	// what the view itself flattened isn't affected by where it is
+	[self.superview _subtreeDidChange];
+
+	// Core Animation autoresizes the subviews' layers along with this one,
+	// without going through their setters
+	[_subviewIndex subviewGeometryDidChange];
+
+	TUIView *superview = self.superview;
+	if(superview)
+		[superview->_subviewIndex subviewGeometryDidChange];
+}
+
+/**
+ * @internal
+ * @brief Send -ancestorDidLayout to every descendant once, at the end of this run loop turn
+ */
+- (void)_setSubviewsNeedAncestorLayout
+{
+	if(_viewFlags.subviewsNeedAncestorLayout || [_subviews count] == 0)
+		return;
+
+	if(!TUIViewsWithPendingAncestorLayout) {
+		TUIViewsWithPendingAncestorLayout = [[NSMutableArray alloc] init];
+		// after frame change notifications and ahead of the display pass and
+		// Core Animation's commit, so hosted NSViews, tiles and restored
+		// contents land in the same frame as the layers around them
+		TUIViewAddMainRunLoopObserver(1999250, TUIViewResolvePendingAncestorLayout);
+	}
+
+	_viewFlags.subviewsNeedAncestorLayout = 1;
+	[TUIViewsWithPendingAncestorLayout addObject:self];
+}
+
+- (TUISubviewIndex *)_subviewIndex
+{
+	if(!_subviewIndex)
+		_subviewIndex = [[TUISubviewIndex alloc] initWithView:self];
+	return _subviewIndex;
 }
 
 - (NSArray *)sortedSubviews // back to front order
 {
-	return [self.subviews sortedArrayWithOptions:NSSortStable usingComparator:(NSComparator)^NSComparisonResult(TUIView *a, TUIView *b) {
-		CGFloat x = a.layer.zPosition;
-		CGFloat y = b.layer.zPosition;
-		if(x > y)
-			return NSOrderedDescending;
-		else if(x < y)
-			return NSOrderedAscending;
-		return NSOrderedSame;
-	}];
+	if([_subviews count] == 0)
+		return [NSArray array];
+	return [[[self _subviewIndex] sortedSubviews] copy];
+}
+
+- (NSArray *)_sortedSubviewsAtPoint:(CGPoint)point
+{
+	if([_subviews count] == 0)
+		return nil;
+	return [[self _subviewIndex] sortedSubviewsAtPoint:point];
+}
+
+- (BOOL)indexesSubviewsForHitTesting
+{
+	return _subviewIndex.usesSpatialIndex;
+}
+
+- (void)setIndexesSubviewsForHitTesting:(BOOL)indexes
+{
+	[self _subviewIndex].usesSpatialIndex = indexes;
+}
+
+- (BOOL)postsFrameChangedNotifications
+{
+	return _viewFlags.postsFrameChangedNotifications;
+}
+
+- (void)setPostsFrameChangedNotifications:(BOOL)posts
+{
+	_viewFlags.postsFrameChangedNotifications = posts;
+}
+
+- (void)_subviewConstraintsDidChange
+{
+	BOOL constrained = NO;
+	for(TUIView *subview in _subviews) {
+		if(TUIViewIsConstrainedToSuperview(subview)) {
+			constrained = YES;
+			break;
+		}
+	}
+	_viewFlags.postsFrameChangesForSubviewConstraints = constrained;
 }
 
 - (TUIView *)hitTest:(CGPoint)point withEvent:(id)event
@@ -661,7 +1807,7 @@ static void TUISetCurrentContextScaleFactor(CGFloat s)
 		return nil;
 	
 	if([self pointInside:point withEvent:event]) {
-		NSArray *s = [self sortedSubviews];
+		NSArray *s = [self _sortedSubviewsAtPoint:point];
 		for(TUIView *v in [s reverseObjectEnumerator]) {
 			TUIView *hit = [v hitTest:[self convertPoint:point toView:v] withEvent:event];
 			if(hit)
@@ -756,6 +1902,7 @@ static void TUISetCurrentContextScaleFactor(CGFloat s)
 	
 	TUIView *superview = [self superview];
 	if(superview) {
+		[superview _subtreeDidChange];
 		TUINSView *nsView = self.ancestorTUINSView;
 		[self willMoveToTUINSView:nil];
 
@@ -763,6 +1910,10 @@ static void TUISetCurrentContextScaleFactor(CGFloat s)
 		[self willMoveToSuperview:nil];
 
 		[superview.subviews removeObjectIdenticalTo:self];
+		[superview->_subviewIndex didRemoveSubview:self];
+		if(superview->_viewFlags.postsFrameChangesForSubviewConstraints && TUIViewIsConstrainedToSuperview(self))
+			[superview _subviewConstraintsDidChange];
+		TUIViewHitTestGeneration++;
 		[self.layer removeFromSuperlayer];
 		self.nsView = nil;
 
@@ -907,6 +2058,11 @@ static void TUISetCurrentContextScaleFactor(CGFloat s)
 }
 
 - (void)willMoveToWindow:(TUINSWindow *)newWindow {
+	if (!newWindow)
+		[[TUIDrawScheduler sharedScheduler] cancelDrawForOwner:self];
+	[self _stopCountingStaticFrames];
+	[self _unflattenSubviews];
+
 	for(TUIView *subview in self.subviews) {
 		[subview willMoveToWindow:newWindow];
 	}
@@ -916,6 +2072,8 @@ static void TUISetCurrentContextScaleFactor(CGFloat s)
 
 - (void)didMoveToWindow {
 	[self _updateLayerScaleFactor];
+	[self _restoreDiscardedContentsIfVisible];
+	[self _startCountingStaticFrames];
 	
 	[self.subviews makeObjectsPerformSelector:_cmd];
 	
@@ -1006,6 +2164,14 @@ static void TUISetCurrentContextScaleFactor(CGFloat s)
 	[TUIView setAnimateContents:s];
 }
 
++ (void)drawRectImplementationsDidChange
+{
+	OSSpinLockLock(&TUIViewDrawRectIMPsLock);
+	if(TUIViewDrawRectIMPs)
+		CFDictionaryRemoveAllValues(TUIViewDrawRectIMPs);
+	OSSpinLockUnlock(&TUIViewDrawRectIMPsLock);
+}
+
 // drawRect isn't called (by -displayLayer:) unless it's overridden by subclasses (which may then call [super drawRect:])
 - (void)drawRect:(CGRect)rect
 {
@@ -1033,13 +2199,23 @@ static void TUISetCurrentContextScaleFactor(CGFloat s)
 
 - (void)setNeedsDisplay
 {
-	[self.layer setNeedsDisplay];
+	[self _subtreeDidChange];
+	[self _invalidateDisplayList];
+	[self _setNeedsRedisplay];
 }
 
 - (void)setNeedsDisplayInRect:(CGRect)rect
 {
-	_context.dirtyRect = rect;
-	[self.layer setNeedsDisplayInRect:rect];
+	[self _subtreeDidChange];
+	[self _invalidateDisplayList];
+	TUIDirtyRegionAddRect(&_context.dirtyRegion, rect);
+	[self _queueDisplay];
+}
+
+- (void)displayIfNeeded
+{
+	[[TUIDisplayPass sharedDisplayPass] displayViewIfNeeded:self];
+	[self.layer displayIfNeeded];
 }
 
 - (BOOL)clipsToBounds
@@ -1059,7 +2235,9 @@ static void TUISetCurrentContextScaleFactor(CGFloat s)
 
 - (void)setAlpha:(CGFloat)a
 {
+	[self.superview _subtreeDidChange];
 	self.layer.opacity = a;
+	TUIViewHitTestGeneration++;
 }
 
 - (BOOL)isOpaque
@@ -1069,18 +2247,59 @@ static void TUISetCurrentContextScaleFactor(CGFloat s)
 
 - (void)setOpaque:(BOOL)o
 {
+	_viewFlags.opaqueSetExplicitly = 1;
 	self.layer.opaque = o;
+	if(!o && TUIViewReportsAvoidableBlending)
+		[self _updateInferredOpacity];
+}
+
++ (BOOL)reportsAvoidableBlending
+{
+	return TUIViewReportsAvoidableBlending;
+}
+
++ (void)setReportsAvoidableBlending:(BOOL)reports
+{
+	TUIViewReportsAvoidableBlending = reports;
+}
+
+- (BOOL)_drawsOpaqueContent
+{
+	return NO;
+}
+
+- (void)_updateInferredOpacity
+{
+	CGColorRef color = self.layer.backgroundColor;
+	BOOL opaqueBackground = (color != NULL && CGColorGetAlpha(color) >= 1.0);
+
+	if(opaqueBackground || [self _drawsOpaqueContent]) {
+		if(!_viewFlags.opaqueSetExplicitly)
+			self.layer.opaque = YES;
+		else if(!self.layer.opaque && TUIViewReportsAvoidableBlending)
+			TUIViewReportAvoidableBlending(self, opaqueBackground ? @"its background color is opaque" : @"its content covers it opaquely");
+	} else if(color != NULL || !_viewFlags.opaqueSetExplicitly) {
+		// a translucent background shows through whatever is drawn, and
+		// without any background, nothing else made the view opaque
+		self.layer.opaque = NO;
+	}
 }
 
 - (BOOL)isHidden
 {
+	// hidden only because a superview draws it into its own contents
+	if(_viewFlags.hiddenByFlattening)
+		return NO;
 	return self.layer.hidden;
 }
 
 - (void)setHidden:(BOOL)h
 {
+	[self.superview _subtreeDidChange];
 	self.layer.hidden = h;
-	[self.subviews makeObjectsPerformSelector:@selector(ancestorDidLayout)];
+	TUIViewHitTestGeneration++;
+	[self _restoreDiscardedContentsIfVisible];
+	[self _setSubviewsNeedAncestorLayout];
 }
 
 - (NSColor *)backgroundColor
@@ -1091,8 +2310,9 @@ static void TUISetCurrentContextScaleFactor(CGFloat s)
 - (void)setBackgroundColor:(NSColor *)color
 {
 	self.layer.backgroundColor = color.tui_CGColor;
-	if(color.alphaComponent < 1.0)
-		self.opaque = NO;
+	if(color == nil)
+		self.layer.opaque = NO;
+	[self _updateInferredOpacity];
 
 	[self setNeedsDisplay];
 }
@@ -20,6 +20,7 @@
 
 #import "TUIViewNSViewContainer.h"
 #import "CATransaction+TUIExtensions.h"
+#import "TUIDisplayPass.h"
 #import "TUINSView.h"
 #import "TUINSView+Private.h"
 #import "TUIViewNSViewContainer+Private.h"
@@ -202,6 +203,7 @@
 	if (_renderingContainedViewCount++ == 0) {
 		[CATransaction tui_performWithDisabledActions:^{
 			[self synchronizeNSViewAppearance];
+			[[TUIDisplayPass sharedDisplayPass] displayPendingViews];
 			[self.rootView displayIfNeeded];
 			[self.layer display];
 		}];